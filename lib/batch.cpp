@@ -0,0 +1,197 @@
+#include "batch.h"
+#include "pipeline.h"
+#include "bilevel_writer.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace cv;
+
+/*
+ La funzione costruisce la lista delle immagini da elaborare. Se source è una cartella vengono considerati tutti i
+ file con un'estensione riconosciuta, in ordine alfabetico; altrimenti source è interpretato come un manifest,
+ ovvero un file di testo contenente un percorso per riga. Le righe vuote e quelle che iniziano con '#' sono ignorate.
+*/
+
+std::vector<std::string> collect_batch_inputs(const std::string &source) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+
+    if (fs::is_directory(source)) {
+        const char* extensions[] = {".jpg", ".jpeg", ".png", ".tif", ".tiff", ".bmp"};
+        for (const auto &entry : fs::directory_iterator(source)) {
+            if (!entry.is_regular_file()) continue;
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            for (const char* accepted : extensions) {
+                if (extension == accepted) {
+                    paths.push_back(entry.path().string());
+                    break;
+                }
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest) {
+        std::cerr<<"batch.collect_batch_inputs(): cannot open "<<source<<"\n";
+        exit(1);
+    }
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        paths.push_back(line);
+    }
+    return paths;
+}
+
+/*
+ Il risultato di un'immagine prende il nome del file di input, estensione compresa, seguito dall'estensione del
+ formato di output: scan.jpg diventa scan.jpg.png, e non si sovrappone al risultato di scan.png. Due file con lo
+ stesso nome in cartelle diverse (o lo stesso file elencato due volte in un manifest) produrrebbero invece lo stesso
+ risultato: process_batch lo rileva prima di iniziare l'elaborazione e termina il programma.
+*/
+
+static std::filesystem::path output_path(const std::string &input_path, const BatchOptions &options) {
+    namespace fs = std::filesystem;
+    std::string extension = options.bilevel_format == "tiff" ? ".tif" : ".png";
+    return fs::path(options.output_dir) / (fs::path(input_path).filename().string() + extension);
+}
+
+static void check_output_paths(const std::vector<std::string> &input_paths, const BatchOptions &options) {
+    std::unordered_map<std::string, const std::string*> outputs;
+    for (const std::string &input_path : input_paths) {
+        auto inserted = outputs.emplace(output_path(input_path, options).string(), &input_path);
+        if (!inserted.second) {
+            std::cerr<<"batch.process_batch(): "<<*inserted.first->second<<" and "<<input_path
+                     <<" would both be written to "<<inserted.first->first<<"\n";
+            exit(1);
+        }
+    }
+}
+
+/*
+ La funzione elabora le immagini indicate in input_paths utilizzando options.workers thread. I thread si
+ contendono un indice condiviso che punta alla prossima immagine da elaborare, quindi il carico si bilancia da sé
+ anche quando le immagini hanno dimensioni molto diverse.
+ Ogni fase della pipeline usa a sua volta il pool di thread di OpenCV: con più worker e il numero di thread di OpenCV
+ lasciato al default (un thread per core), la macchina eseguirebbe circa workers x core thread. In questo caso OpenCV
+ viene quindi limitato ad un thread, e le immagini sono parallelizzate solo tra i worker. Il numero di thread di
+ OpenCV è un'impostazione globale del processo, che viene ripristinata al termine dell'elaborazione.
+*/
+
+BatchReport process_batch(const std::vector<std::string> &input_paths, const BatchOptions &options) {
+    namespace fs = std::filesystem;
+    using clock = std::chrono::steady_clock;
+
+    int previous_opencv_threads = getNumThreads();
+    int workers = std::max(1, options.workers);
+    if (options.opencv_threads >= 0) setNumThreads(options.opencv_threads);
+    else if (workers > 1) setNumThreads(1);
+    if (!options.output_dir.empty()) {
+        check_output_paths(input_paths, options);
+        fs::create_directories(options.output_dir);
+    }
+
+    BatchReport report;
+    report.latencies.reserve(input_paths.size());
+    std::atomic<size_t> next_task(0);
+    std::mutex report_mutex;
+    bool tracing = !options.trace_path.empty();
+    std::vector<PipelineStats> trace;
+
+    auto worker = [&] (int worker_id) -> void {
+        // Ogni thread mantiene il proprio workspace, riutilizzato per tutte le immagini che elabora
+        Workspace workspace;
+        for (;;) {
+            size_t task = next_task++;
+            if (task >= input_paths.size()) return;
+
+            auto start = clock::now();
+            bool success = false;
+            PipelineStats stats;
+            stats.label = input_paths[task];
+            stats.thread = worker_id;
+            try {
+                Mat input_image = imread(input_paths[task], IMREAD_COLOR);
+                if (!input_image.empty()) {
+                    std::string output = output_path(input_paths[task], options).string();
+                    PipelineStats* task_stats = tracing ? &stats : nullptr;
+                    if (!options.bilevel_format.empty()) {
+                        BilevelImage output_image;
+                        execute_processing_pipeline(input_image, options.config, workspace, output_image, task_stats);
+                        success = options.output_dir.empty() || write_bilevel_image(output, output_image);
+                    }
+                    else {
+                        Mat output_image = execute_processing_pipeline(input_image, options.config, workspace, task_stats);
+                        success = options.output_dir.empty() || imwrite(output, output_image);
+                    }
+                }
+            }
+            catch (const std::exception &e) {
+                std::cerr<<"batch.process_batch(): "<<input_paths[task]<<": "<<e.what()<<"\n";
+            }
+            double latency = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(report_mutex);
+            if (tracing && !stats.stages.empty()) trace.push_back(stats);
+            if (success) {
+                report.processed++;
+                report.latencies.push_back(latency);
+            }
+            else {
+                report.failed++;
+                std::cerr<<"batch.process_batch(): failed to process "<<input_paths[task]<<"\n";
+            }
+        }
+    };
+
+    auto start = clock::now();
+    std::vector<std::thread> threads;
+    for (int i=0; i<workers; ++i) threads.emplace_back(worker, i);
+    for (auto &thread : threads) thread.join();
+    report.wall_time = std::chrono::duration<double>(clock::now() - start).count();
+    setNumThreads(previous_opencv_threads);
+
+    std::sort(report.latencies.begin(), report.latencies.end());
+    if (tracing) {
+        FILE* stream = fopen(options.trace_path.c_str(), "w");
+        if (!stream) std::cerr<<"batch.process_batch(): cannot write the trace to "<<options.trace_path<<"\n";
+        else {
+            write_chrome_trace(trace, stream);
+            fclose(stream);
+        }
+    }
+    return report;
+}
+
+double BatchReport::images_per_second() const {
+    return wall_time > 0 ? processed / wall_time : 0;
+}
+
+/*
+ Il percentile è calcolato con il metodo nearest-rank sulle latenze ordinate.
+*/
+
+double BatchReport::latency_percentile(double percentile) const {
+    if (latencies.empty()) return 0;
+    auto rank = (size_t) std::ceil(percentile / 100.0 * latencies.size());
+    if (rank > 0) rank--;
+    return latencies[std::min(rank, latencies.size() - 1)];
+}
+
+void BatchReport::print(FILE* stream) const {
+    fprintf(stream, "processed: %d, failed: %d, wall time: %.2f s\n", processed, failed, wall_time);
+    fprintf(stream, "throughput: %.2f images/s\n", images_per_second());
+    fprintf(stream, "latency p50: %.1f ms, p99: %.1f ms\n", latency_percentile(50), latency_percentile(99));
+}
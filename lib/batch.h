@@ -0,0 +1,52 @@
+#ifndef SERVER_APP_BATCH_H
+#define SERVER_APP_BATCH_H
+
+#include "pipeline.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ Questo modulo permette di elaborare un insieme di immagini tramite la pipeline di elaborazione, distribuendo il
+ lavoro su un certo numero di thread. Ogni immagine costituisce un task indipendente: un thread preleva il percorso
+ della prossima immagine da elaborare, la carica, la elabora, salva il risultato e solo allora passa alla successiva.
+ In questo modo il numero di immagini contemporaneamente in memoria non supera mai il numero di thread.
+*/
+
+class BatchOptions {
+public:
+    // Numero di thread che elaborano le immagini
+    int workers = 1;
+    // Numero di thread che OpenCV può utilizzare all'interno di ciascun task. Con -1 OpenCV usa un solo thread se i
+    // worker sono più di uno, altrimenti il valore di default.
+    int opencv_threads = -1;
+    // Cartella in cui salvare le immagini elaborate. Se vuota i risultati vengono scartati.
+    std::string output_dir;
+    // Se vale "tiff" o "png" le immagini elaborate vengono salvate ad un bit per pixel, come TIFF con compressione
+    // CCITT Group 4 o come PNG ad un bit (vedi bilevel_writer.h); se è vuoto vengono salvate come PNG ad 8 bit.
+    std::string bilevel_format;
+    // Parametri della pipeline, condivisi in sola lettura da tutti i thread
+    ProcessingConfig config;
+    // Se non è vuoto, i tempi e la memoria delle fasi di ogni immagine vengono scritti in questo file come trace
+    // event di Chrome (vedi pipeline_trace.h)
+    std::string trace_path;
+};
+
+class BatchReport {
+public:
+    int processed = 0;
+    int failed = 0;
+    // Durata complessiva dell'elaborazione, in secondi
+    double wall_time = 0;
+    // Latenze dei singoli task (caricamento, elaborazione e salvataggio), in millisecondi, ordinate
+    std::vector<double> latencies;
+
+    double images_per_second() const;
+    double latency_percentile(double percentile) const;
+    void print(FILE* stream) const;
+};
+
+std::vector<std::string> collect_batch_inputs(const std::string &source);
+BatchReport process_batch(const std::vector<std::string> &input_paths, const BatchOptions &options);
+
+#endif
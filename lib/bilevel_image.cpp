@@ -0,0 +1,61 @@
+#include "bilevel_image.h"
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+BilevelImage::BilevelImage(int rows, int cols) {
+    create(rows, cols);
+}
+
+BilevelImage::BilevelImage(const Mat &binarized_image) {
+    pack(binarized_image);
+}
+
+void BilevelImage::create(int rows, int cols) {
+    if (rows < 0 || cols < 0) {
+        std::cerr<<"bilevel_image.create(): The size of the image must not be negative\n";
+        exit(1);
+    }
+    height = rows;
+    width = cols;
+    stride = (cols + 7) / 8;
+    bits.resize((size_t) height * stride);
+}
+
+void BilevelImage::pack_row(const unsigned char* pixels, int cols, unsigned char* packed) {
+    int full_bytes = cols / 8;
+    for (int i=0; i<full_bytes; ++i) {
+        const unsigned char* p = pixels + 8*i;
+        packed[i] = (unsigned char) ((p[0] != 0) << 7 | (p[1] != 0) << 6 | (p[2] != 0) << 5 | (p[3] != 0) << 4 |
+                                     (p[4] != 0) << 3 | (p[5] != 0) << 2 | (p[6] != 0) << 1 | (p[7] != 0));
+    }
+    if (cols % 8) {
+        unsigned char last = 0;
+        for (int col=full_bytes*8; col<cols; ++col) last |= (unsigned char) ((pixels[col] != 0) << (7 - (col&7)));
+        packed[full_bytes] = last;
+    }
+}
+
+void BilevelImage::pack(const Mat &binarized_image) {
+    if (binarized_image.type() != CV_8U) {
+        std::cerr<<"bilevel_image.pack(): The binarized image must be a single channel, 8 bit image\n";
+        exit(1);
+    }
+    create(binarized_image.size[0], binarized_image.size[1]);
+    parallel_for_(Range(0, height), [&] (const Range &range) -> void {
+        for (int r=range.start; r<range.end; ++r) {
+            pack_row(binarized_image.ptr<unsigned char>(r), width, row(r));
+        }
+    });
+}
+
+Mat BilevelImage::unpack() const {
+    Mat binarized_image(height, width, CV_8U);
+    parallel_for_(Range(0, height), [&] (const Range &range) -> void {
+        for (int r=range.start; r<range.end; ++r) {
+            unsigned char* pixels = binarized_image.ptr<unsigned char>(r);
+            for (int col=0; col<width; ++col) pixels[col] = white(r, col) ? 255 : 0;
+        }
+    });
+    return binarized_image;
+}
@@ -0,0 +1,47 @@
+#ifndef SERVER_APP_BILEVEL_IMAGE_H
+#define SERVER_APP_BILEVEL_IMAGE_H
+
+#include "opencv2/opencv.hpp"
+#include <vector>
+using namespace cv;
+
+/*
+ Questo modulo contiene la rappresentazione ad un bit per pixel dell'immagine binarizzata, che occupa un ottavo della
+ memoria della matrice ad 8 bit prodotta dalle binarizzazioni. Ogni riga occupa (cols + 7) / 8 byte; il pixel di
+ colonna c si trova nel bit 7 - c % 8 del byte c / 8, ovvero i pixel sono ordinati dal bit più significativo, come
+ nei formati PNG e TIFF. Un bit a 1 indica un pixel bianco, un bit a 0 un pixel nero (come nel PNG in scala di
+ grigio ad un bit). I bit oltre l'ultima colonna sono nulli.
+*/
+
+class BilevelImage {
+public:
+    BilevelImage() = default;
+    explicit BilevelImage(int rows, int cols);
+    // I pixel non nulli di binarized_image, che deve essere di tipo CV_8U, sono bianchi.
+    explicit BilevelImage(const Mat &binarized_image);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    int row_bytes() const { return stride; }
+    unsigned char* row(int row) { return &bits[(size_t) row*stride]; }
+    const unsigned char* row(int row) const { return &bits[(size_t) row*stride]; }
+    bool white(int row, int col) const {
+        return (bits[(size_t) row*stride + (col>>3)] >> (7 - (col&7))) & 1;
+    }
+
+    // Ridimensiona l'immagine, riallocando la memoria solo se non basta. Il contenuto non è inizializzato.
+    void create(int rows, int cols);
+    // Comprime binarized_image, riutilizzando la memoria già allocata.
+    void pack(const Mat &binarized_image);
+    // Restituisce l'immagine ad 8 bit, con i valori 0 e 255.
+    Mat unpack() const;
+
+    // Comprime una riga di cols pixel ad 8 bit in (cols + 7) / 8 byte.
+    static void pack_row(const unsigned char* pixels, int cols, unsigned char* packed);
+
+private:
+    int height = 0, width = 0, stride = 0;
+    std::vector<unsigned char> bits;
+};
+
+#endif
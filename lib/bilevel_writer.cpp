@@ -0,0 +1,394 @@
+#include "bilevel_writer.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+BilevelWriter::BilevelWriter(const std::string &path, int width, int height, int dpi) {
+    if (width <= 0 || height <= 0) {
+        std::cerr<<"bilevel_writer.BilevelWriter(): The size of the image must be positive\n";
+        exit(1);
+    }
+    this->width = width;
+    this->height = height;
+    this->dpi = dpi;
+    packed_row.resize((width + 7) / 8);
+    stream = fopen(path.c_str(), "wb");
+}
+
+BilevelWriter::~BilevelWriter() {
+    if (stream) fclose(stream);
+}
+
+void BilevelWriter::write_bytes(const void* data, size_t size) {
+    if (!good() || !size) return;
+    if (fwrite(data, 1, size, stream) != size) failed = true;
+}
+
+void BilevelWriter::write_row(const unsigned char* packed_row) {
+    if (rows_written >= height) {
+        std::cerr<<"bilevel_writer.write_row(): The image has only "<<height<<" rows\n";
+        exit(1);
+    }
+    if (good()) encode_row(packed_row);
+    ++rows_written;
+}
+
+void BilevelWriter::write_pixels(const unsigned char* pixels) {
+    BilevelImage::pack_row(pixels, width, packed_row.data());
+    write_row(packed_row.data());
+}
+
+bool BilevelWriter::finish() {
+    if (rows_written != height) {
+        std::cerr<<"bilevel_writer.finish(): "<<rows_written<<" rows of "<<height<<" have been written\n";
+        exit(1);
+    }
+    if (!stream) return false;
+    if (!failed) finish_file();
+    if (fclose(stream)) failed = true;
+    stream = nullptr;
+    return !failed;
+}
+
+/*
+ Codici di Huffman modificati di ITU-T T.4, utilizzati dalla modalità orizzontale di T.6: il codice di terminazione
+ per le sequenze da 0 a 63 pixel, il codice di makeup per i multipli di 64 fino a 1728, ed i codici di makeup estesi,
+ comuni ai due colori, da 1792 a 2560. Ogni codice è dato dal valore e dal numero di bit.
+*/
+
+struct FaxCode {
+    uint16_t code;
+    uint8_t length;
+};
+
+static const FaxCode WHITE_TERMINATING[64] = {
+        {0x35, 8}, {0x7, 6}, {0x7, 4}, {0x8, 4}, {0xb, 4}, {0xc, 4},
+        {0xe, 4}, {0xf, 4}, {0x13, 5}, {0x14, 5}, {0x7, 5}, {0x8, 5},
+        {0x8, 6}, {0x3, 6}, {0x34, 6}, {0x35, 6}, {0x2a, 6}, {0x2b, 6},
+        {0x27, 7}, {0xc, 7}, {0x8, 7}, {0x17, 7}, {0x3, 7}, {0x4, 7},
+        {0x28, 7}, {0x2b, 7}, {0x13, 7}, {0x24, 7}, {0x18, 7}, {0x2, 8},
+        {0x3, 8}, {0x1a, 8}, {0x1b, 8}, {0x12, 8}, {0x13, 8}, {0x14, 8},
+        {0x15, 8}, {0x16, 8}, {0x17, 8}, {0x28, 8}, {0x29, 8}, {0x2a, 8},
+        {0x2b, 8}, {0x2c, 8}, {0x2d, 8}, {0x4, 8}, {0x5, 8}, {0xa, 8},
+        {0xb, 8}, {0x52, 8}, {0x53, 8}, {0x54, 8}, {0x55, 8}, {0x24, 8},
+        {0x25, 8}, {0x58, 8}, {0x59, 8}, {0x5a, 8}, {0x5b, 8}, {0x4a, 8},
+        {0x4b, 8}, {0x32, 8}, {0x33, 8}, {0x34, 8},
+};
+static const FaxCode WHITE_MAKEUP[27] = {
+        {0x1b, 5}, {0x12, 5}, {0x17, 6}, {0x37, 7}, {0x36, 8}, {0x37, 8},
+        {0x64, 8}, {0x65, 8}, {0x68, 8}, {0x67, 8}, {0xcc, 9}, {0xcd, 9},
+        {0xd2, 9}, {0xd3, 9}, {0xd4, 9}, {0xd5, 9}, {0xd6, 9}, {0xd7, 9},
+        {0xd8, 9}, {0xd9, 9}, {0xda, 9}, {0xdb, 9}, {0x98, 9}, {0x99, 9},
+        {0x9a, 9}, {0x18, 6}, {0x9b, 9},
+};
+static const FaxCode BLACK_TERMINATING[64] = {
+        {0x37, 10}, {0x2, 3}, {0x3, 2}, {0x2, 2}, {0x3, 3}, {0x3, 4},
+        {0x2, 4}, {0x3, 5}, {0x5, 6}, {0x4, 6}, {0x4, 7}, {0x5, 7},
+        {0x7, 7}, {0x4, 8}, {0x7, 8}, {0x18, 9}, {0x17, 10}, {0x18, 10},
+        {0x8, 10}, {0x67, 11}, {0x68, 11}, {0x6c, 11}, {0x37, 11}, {0x28, 11},
+        {0x17, 11}, {0x18, 11}, {0xca, 12}, {0xcb, 12}, {0xcc, 12}, {0xcd, 12},
+        {0x68, 12}, {0x69, 12}, {0x6a, 12}, {0x6b, 12}, {0xd2, 12}, {0xd3, 12},
+        {0xd4, 12}, {0xd5, 12}, {0xd6, 12}, {0xd7, 12}, {0x6c, 12}, {0x6d, 12},
+        {0xda, 12}, {0xdb, 12}, {0x54, 12}, {0x55, 12}, {0x56, 12}, {0x57, 12},
+        {0x64, 12}, {0x65, 12}, {0x52, 12}, {0x53, 12}, {0x24, 12}, {0x37, 12},
+        {0x38, 12}, {0x27, 12}, {0x28, 12}, {0x58, 12}, {0x59, 12}, {0x2b, 12},
+        {0x2c, 12}, {0x5a, 12}, {0x66, 12}, {0x67, 12},
+};
+static const FaxCode BLACK_MAKEUP[27] = {
+        {0xf, 10}, {0xc8, 12}, {0xc9, 12}, {0x5b, 12}, {0x33, 12}, {0x34, 12},
+        {0x35, 12}, {0x6c, 13}, {0x6d, 13}, {0x4a, 13}, {0x4b, 13}, {0x4c, 13},
+        {0x4d, 13}, {0x72, 13}, {0x73, 13}, {0x74, 13}, {0x75, 13}, {0x76, 13},
+        {0x77, 13}, {0x52, 13}, {0x53, 13}, {0x54, 13}, {0x55, 13}, {0x5a, 13},
+        {0x5b, 13}, {0x64, 13}, {0x65, 13},
+};
+static const FaxCode EXTENDED_MAKEUP[13] = {
+        {0x8, 11}, {0xc, 11}, {0xd, 11}, {0x12, 12}, {0x13, 12}, {0x14, 12},
+        {0x15, 12}, {0x16, 12}, {0x17, 12}, {0x1c, 12}, {0x1d, 12}, {0x1e, 12},
+        {0x1f, 12},
+};
+
+// Modalità verticale, indicizzata da a1 - b1 + 3
+static const FaxCode VERTICAL[7] = {{0x2, 7}, {0x2, 6}, {0x2, 3}, {0x1, 1}, {0x3, 3}, {0x3, 6}, {0x3, 7}};
+static const FaxCode PASS = {0x1, 4};
+static const FaxCode HORIZONTAL = {0x1, 3};
+static const FaxCode EOL = {0x1, 12};
+
+#define TIFF_ENTRIES 13
+#define OUTPUT_BUFFER_SIZE 65536
+
+static void put_u16(std::vector<unsigned char> &data, uint32_t value) {
+    data.push_back((unsigned char) value);
+    data.push_back((unsigned char) (value >> 8));
+}
+
+static void put_u32(std::vector<unsigned char> &data, uint32_t value) {
+    for (int shift=0; shift<32; shift+=8) data.push_back((unsigned char) (value >> shift));
+}
+
+static void put_entry(std::vector<unsigned char> &data, uint16_t tag, uint16_t type, uint32_t value) {
+    put_u16(data, tag);
+    put_u16(data, type);
+    put_u32(data, 1);
+    // I valori SHORT occupano i primi due byte del campo
+    if (type == 3) {
+        put_u16(data, value);
+        put_u16(data, 0);
+    }
+    else put_u32(data, value);
+}
+
+TiffG4Writer::TiffG4Writer(const std::string &path, int width, int height, int dpi)
+        : BilevelWriter(path, width, height, dpi) {
+    // Intestazione little endian; l'offset della directory viene scritto da finish_file.
+    const unsigned char header[8] = {'I', 'I', 42, 0, 0, 0, 0, 0};
+    write_bytes(header, sizeof(header));
+    // La riga di riferimento della prima riga è una riga immaginaria interamente bianca.
+    reference_changes.assign(3, width);
+    coding_changes.reserve(width + 3);
+    reference_changes.reserve(width + 3);
+    output.reserve(OUTPUT_BUFFER_SIZE);
+}
+
+void TiffG4Writer::put_bits(uint32_t code, int length) {
+    bit_buffer = (bit_buffer << length) | code;
+    bit_count += length;
+    while (bit_count >= 8) {
+        bit_count -= 8;
+        output.push_back((unsigned char) (bit_buffer >> bit_count));
+    }
+    bit_buffer &= ((uint64_t) 1 << bit_count) - 1;
+    if (output.size() >= OUTPUT_BUFFER_SIZE) flush_bits(false);
+}
+
+void TiffG4Writer::flush_bits(bool pad) {
+    if (pad && bit_count) {
+        output.push_back((unsigned char) (bit_buffer << (8 - bit_count)));
+        bit_buffer = 0;
+        bit_count = 0;
+    }
+    write_bytes(output.data(), output.size());
+    data_bytes += (uint32_t) output.size();
+    output.clear();
+}
+
+// Le sequenze più lunghe di 2623 pixel sono precedute da uno o più codici di makeup per 2560 pixel.
+void TiffG4Writer::put_run(int run, bool white) {
+    const FaxCode* terminating = white ? WHITE_TERMINATING : BLACK_TERMINATING;
+    const FaxCode* makeup = white ? WHITE_MAKEUP : BLACK_MAKEUP;
+    while (run >= 2624) {
+        put_bits(EXTENDED_MAKEUP[12].code, EXTENDED_MAKEUP[12].length);
+        run -= 2560;
+    }
+    if (run >= 64) {
+        int length = run / 64 * 64;
+        const FaxCode &code = length <= 1728 ? makeup[length/64 - 1] : EXTENDED_MAKEUP[(length - 1792) / 64];
+        put_bits(code.code, code.length);
+        run -= length;
+    }
+    put_bits(terminating[run].code, terminating[run].length);
+}
+
+/*
+ La codifica bidimensionale di T.6. a0 è la posizione corrente sulla riga da codificare (inizialmente la posizione
+ immaginaria -1, bianca), a1 ed a2 sono le due posizioni successive in cui la riga cambia colore, b1 è la prima
+ posizione dopo a0 in cui la riga di riferimento cambia verso il colore opposto a quello di a0, e b2 la successiva.
+ Se b2 precede a1 si usa la modalità pass; se a1 dista al più 3 pixel da b1 la modalità verticale; altrimenti la
+ modalità orizzontale, che codifica le sequenze a0a1 ed a1a2 con i codici di T.4.
+ Le posizioni dei cambi di colore sono seguite da tre sentinelle pari a width: nella riga di riferimento il cambio
+ di indice pari è sempre verso il nero, perché ogni riga inizia bianca.
+*/
+
+void TiffG4Writer::encode_row(const unsigned char* packed_row) {
+    coding_changes.clear();
+    bool white = true;
+    int row_bytes = (width + 7) / 8;
+    for (int i=0; i<row_bytes; ++i) {
+        unsigned char byte = packed_row[i];
+        if (byte == (white ? 0xFF : 0x00)) continue;
+        int last = std::min(8, width - 8*i);
+        for (int k=0; k<last; ++k) {
+            bool pixel_white = (byte >> (7 - k)) & 1;
+            if (pixel_white != white) {
+                coding_changes.push_back(8*i + k);
+                white = pixel_white;
+            }
+        }
+    }
+    coding_changes.insert(coding_changes.end(), 3, width);
+
+    const std::vector<int> &coding = coding_changes, &reference = reference_changes;
+    int a0 = -1;
+    white = true;
+    size_t a1_index = 0, b_index = 0;
+    for (;;) {
+        while (coding[a1_index] <= a0) ++a1_index;
+        while (reference[b_index] <= a0) ++b_index;
+        size_t b1_index = b_index + ((b_index % 2 == 0) != white);
+        int a1 = coding[a1_index], b1 = reference[b1_index], b2 = reference[b1_index + 1];
+
+        if (b2 < a1) {
+            put_bits(PASS.code, PASS.length);
+            a0 = b2;
+        }
+        else if (std::abs(a1 - b1) <= 3) {
+            put_bits(VERTICAL[a1 - b1 + 3].code, VERTICAL[a1 - b1 + 3].length);
+            a0 = a1;
+            white = !white;
+        }
+        else {
+            int a2 = coding[a1_index + 1];
+            put_bits(HORIZONTAL.code, HORIZONTAL.length);
+            put_run(a1 - std::max(a0, 0), white);
+            put_run(a2 - a1, !white);
+            a0 = a2;
+        }
+        if (a0 >= width) break;
+    }
+    reference_changes.swap(coding_changes);
+}
+
+/*
+ La directory contiene i campi richiesti da un TIFF bilevel (Baseline TIFF, sezione 3) con Compression = 4. I dati
+ compressi sono un'unica strip che inizia subito dopo l'intestazione. PhotometricInterpretation vale 0 (WhiteIsZero),
+ come per tutti i TIFF CCITT.
+*/
+
+void TiffG4Writer::finish_file() {
+    put_bits(EOL.code, EOL.length);
+    put_bits(EOL.code, EOL.length);
+    flush_bits(true);
+
+    std::vector<unsigned char> directory;
+    // La directory deve iniziare ad un offset pari.
+    if (data_bytes % 2) directory.push_back(0);
+    uint32_t directory_offset = 8 + data_bytes + (uint32_t) directory.size();
+    uint32_t resolution_offset = directory_offset + 2 + TIFF_ENTRIES*12 + 4;
+
+    put_u16(directory, TIFF_ENTRIES);
+    put_entry(directory, 256, 4, width);              // ImageWidth
+    put_entry(directory, 257, 4, height);             // ImageLength
+    put_entry(directory, 258, 3, 1);                  // BitsPerSample
+    put_entry(directory, 259, 3, 4);                  // Compression: CCITT T.6
+    put_entry(directory, 262, 3, 0);                  // PhotometricInterpretation: WhiteIsZero
+    put_entry(directory, 273, 4, 8);                  // StripOffsets
+    put_entry(directory, 277, 3, 1);                  // SamplesPerPixel
+    put_entry(directory, 278, 4, height);             // RowsPerStrip
+    put_entry(directory, 279, 4, data_bytes);         // StripByteCounts
+    put_entry(directory, 282, 5, resolution_offset);  // XResolution
+    put_entry(directory, 283, 5, resolution_offset);  // YResolution
+    put_entry(directory, 293, 4, 0);                  // T6Options
+    put_entry(directory, 296, 3, 2);                  // ResolutionUnit: pollici
+    put_u32(directory, 0);
+    put_u32(directory, dpi);
+    put_u32(directory, 1);
+    write_bytes(directory.data(), directory.size());
+
+    if (!good() || fseek(stream, 4, SEEK_SET)) {
+        failed = true;
+        return;
+    }
+    std::vector<unsigned char> offset;
+    put_u32(offset, directory_offset);
+    write_bytes(offset.data(), offset.size());
+}
+
+/*
+ Il PNG contiene IHDR (scala di grigio, un bit per pixel, senza interlacciamento), pHYs con la risoluzione, i chunk
+ IDAT con il flusso zlib ed IEND. Ogni riga è preceduta dal filtro None, il più adatto alle immagini ad un bit: le
+ righe compresse di BilevelImage hanno già il formato richiesto dal PNG, in cui un bit a 1 è bianco.
+*/
+
+static void put_u32_be(unsigned char* data, uint32_t value) {
+    data[0] = (unsigned char) (value >> 24);
+    data[1] = (unsigned char) (value >> 16);
+    data[2] = (unsigned char) (value >> 8);
+    data[3] = (unsigned char) value;
+}
+
+PngBilevelWriter::PngBilevelWriter(const std::string &path, int width, int height, int dpi)
+        : BilevelWriter(path, width, height, dpi) {
+    const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    write_bytes(signature, sizeof(signature));
+
+    unsigned char header[13] = {};
+    put_u32_be(header, width);
+    put_u32_be(header + 4, height);
+    header[8] = 1;
+    write_chunk("IHDR", header, sizeof(header));
+
+    unsigned char physical[9] = {};
+    uint32_t pixels_per_meter = (uint32_t) std::lround(dpi / 0.0254);
+    put_u32_be(physical, pixels_per_meter);
+    put_u32_be(physical + 4, pixels_per_meter);
+    physical[8] = 1;
+    write_chunk("pHYs", physical, sizeof(physical));
+
+    deflater.zalloc = Z_NULL;
+    deflater.zfree = Z_NULL;
+    deflater.opaque = Z_NULL;
+    deflater_ready = deflateInit(&deflater, Z_DEFAULT_COMPRESSION) == Z_OK;
+    if (!deflater_ready) failed = true;
+    filtered_row.assign(1 + (width + 7) / 8, 0);
+    compressed.resize(OUTPUT_BUFFER_SIZE);
+}
+
+PngBilevelWriter::~PngBilevelWriter() {
+    if (deflater_ready) deflateEnd(&deflater);
+}
+
+void PngBilevelWriter::write_chunk(const char* type, const unsigned char* data, uint32_t size) {
+    unsigned char length[4];
+    put_u32_be(length, size);
+    write_bytes(length, 4);
+    write_bytes(type, 4);
+    write_bytes(data, size);
+    uLong crc = crc32(0L, (const Bytef*) type, 4);
+    if (size) crc = crc32(crc, data, size);
+    unsigned char checksum[4];
+    put_u32_be(checksum, (uint32_t) crc);
+    write_bytes(checksum, 4);
+}
+
+// Comprime data; ogni volta che il buffer di uscita si riempie il suo contenuto diventa un chunk IDAT.
+void PngBilevelWriter::deflate_data(const unsigned char* data, size_t size, int flush) {
+    deflater.next_in = const_cast<Bytef*>(data);
+    deflater.avail_in = (uInt) size;
+    for (;;) {
+        deflater.next_out = compressed.data();
+        deflater.avail_out = (uInt) compressed.size();
+        int status = deflate(&deflater, flush);
+        if (status == Z_STREAM_ERROR) {
+            failed = true;
+            return;
+        }
+        uint32_t produced = (uint32_t) (compressed.size() - deflater.avail_out);
+        if (produced) write_chunk("IDAT", compressed.data(), produced);
+        if (flush == Z_FINISH ? status == Z_STREAM_END : deflater.avail_out != 0) return;
+    }
+}
+
+void PngBilevelWriter::encode_row(const unsigned char* packed_row) {
+    std::copy(packed_row, packed_row + filtered_row.size() - 1, filtered_row.begin() + 1);
+    deflate_data(filtered_row.data(), filtered_row.size(), Z_NO_FLUSH);
+}
+
+void PngBilevelWriter::finish_file() {
+    deflate_data(nullptr, 0, Z_FINISH);
+    write_chunk("IEND", nullptr, 0);
+}
+
+bool write_bilevel_image(const std::string &path, const BilevelImage &image, int dpi) {
+    if (image.rows() == 0 || image.cols() == 0) return false;
+    std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".tif" || extension == ".tiff") {
+        TiffG4Writer writer(path, image.cols(), image.rows(), dpi);
+        for (int row=0; row<image.rows(); ++row) writer.write_row(image.row(row));
+        return writer.finish();
+    }
+    PngBilevelWriter writer(path, image.cols(), image.rows(), dpi);
+    for (int row=0; row<image.rows(); ++row) writer.write_row(image.row(row));
+    return writer.finish();
+}
@@ -0,0 +1,94 @@
+#ifndef SERVER_APP_BILEVEL_WRITER_H
+#define SERVER_APP_BILEVEL_WRITER_H
+
+#include "bilevel_image.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/*
+ Questo modulo contiene due writer per immagini binarizzate ad un bit per pixel, che ricevono l'immagine una riga
+ alla volta e la scrivono subito su file, senza costruire un'immagine intermedia ad 8 bit né tenere in memoria
+ l'immagine intera: la memoria utilizzata è proporzionale alla larghezza.
+ - TiffG4Writer scrive un TIFF con compressione CCITT Group 4 (ITU-T T.6), il formato più compatto per documenti
+   scannerizzati. Ogni riga è codificata rispetto alla precedente, dunque il writer conserva solo le posizioni in cui
+   cambia il colore della riga precedente. L'immagine è una sola strip; la directory del TIFF, che contiene la
+   dimensione dei dati compressi, viene scritta in fondo al file ed il suo offset viene aggiornato alla chiusura.
+ - PngBilevelWriter scrive un PNG in scala di grigio ad un bit, comprimendo le righe con zlib man mano che arrivano.
+ Le righe possono essere fornite già compresse (nel formato di BilevelImage) oppure ad 8 bit, come quelle prodotte da
+ StreamingBinarization: in questo caso vengono compresse una alla volta.
+ Come imwrite, i writer non interrompono il programma se il file non può essere scritto: finish restituisce falso.
+*/
+
+class BilevelWriter {
+public:
+    virtual ~BilevelWriter();
+    BilevelWriter(const BilevelWriter &) = delete;
+    BilevelWriter &operator=(const BilevelWriter &) = delete;
+
+    // Vero se il file è stato aperto e tutte le scritture finora sono riuscite
+    bool good() const { return stream && !failed; }
+    // Scrive la riga successiva, di (width + 7) / 8 byte, nel formato di BilevelImage.
+    void write_row(const unsigned char* packed_row);
+    // Scrive la riga successiva, di width pixel ad 8 bit: i pixel non nulli sono bianchi.
+    void write_pixels(const unsigned char* pixels);
+    // Completa e chiude il file, dopo che tutte le height righe sono state scritte. Restituisce good().
+    bool finish();
+
+protected:
+    BilevelWriter(const std::string &path, int width, int height, int dpi);
+    virtual void encode_row(const unsigned char* packed_row) = 0;
+    virtual void finish_file() = 0;
+    void write_bytes(const void* data, size_t size);
+
+    FILE* stream = nullptr;
+    bool failed = false;
+    int width, height, dpi;
+    int rows_written = 0;
+
+private:
+    std::vector<unsigned char> packed_row;
+};
+
+class TiffG4Writer : public BilevelWriter {
+public:
+    explicit TiffG4Writer(const std::string &path, int width, int height, int dpi = 300);
+
+private:
+    void encode_row(const unsigned char* packed_row) override;
+    void finish_file() override;
+    void put_bits(uint32_t code, int length);
+    void put_run(int run, bool white);
+    void flush_bits(bool pad);
+
+    // Posizioni in cui cambia il colore della riga precedente e di quella corrente, seguite da tre sentinelle
+    std::vector<int> reference_changes, coding_changes;
+    uint64_t bit_buffer = 0;
+    int bit_count = 0;
+    std::vector<unsigned char> output;
+    uint32_t data_bytes = 0;
+};
+
+class PngBilevelWriter : public BilevelWriter {
+public:
+    explicit PngBilevelWriter(const std::string &path, int width, int height, int dpi = 300);
+    ~PngBilevelWriter() override;
+
+private:
+    void encode_row(const unsigned char* packed_row) override;
+    void finish_file() override;
+    void write_chunk(const char* type, const unsigned char* data, uint32_t size);
+    void deflate_data(const unsigned char* data, size_t size, int flush);
+
+    z_stream deflater;
+    bool deflater_ready = false;
+    std::vector<unsigned char> filtered_row, compressed;
+};
+
+// Scrive image come TIFF con compressione CCITT Group 4 se l'estensione di path è .tif o .tiff, altrimenti come PNG
+// ad un bit. Restituisce falso se il file non può essere scritto.
+bool write_bilevel_image(const std::string &path, const BilevelImage &image, int dpi = 300);
+
+#endif
@@ -2,18 +2,11 @@
 #include "image_statistics.h"
 #include "utility.h"
 #include "pre_processing.h"
+#include "workspace.h"
+#include "integral_statistics.h"
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
-int StatisticsBasedBinarization::BLOCK_SIZE = 9;
-int StatisticsBasedBinarization::CHUNK_SIZE = 37;
-int StatisticsBasedBinarization::CORRECTION_OFFSET = 10;
-
-int FilteringBasedBinarization::BLOCK_SIZE = 19;
-int FilteringBasedBinarization::CORRECTION_OFFSET = 10;
-int FilteringBasedBinarization::BLUR_KERNEL_SIZE = 51;
-int FilteringBasedBinarization::THRESHOLD = 10;
-
 /*
  La seguente funzione binarizza un immagine sulla base delle realtive statistiche locali. Come primo passaggio viene 
  calcolata una maschera che identifica all'interno dell'immagine le regioni contenenti testo scritto, confrontando
@@ -23,62 +16,119 @@ int FilteringBasedBinarization::THRESHOLD = 10;
  la varianza locale è maggiore della varianza globale.
 */
 
-Mat StatisticsBasedBinarization::binarize_image(const Mat &input_image) {
-    Mat binarized_image = input_image.clone();
-    if (binarized_image.channels() == 3) cvtColor(binarized_image, binarized_image, COLOR_RGB2GRAY);
+Mat StatisticsBasedBinarization::binarize_image(const Mat &input_image) const {
+    Workspace workspace;
+    Mat binarized_image;
+    binarize_image(input_image, binarized_image, workspace);
+    return binarized_image;
+}
+
+void StatisticsBasedBinarization::binarize_image(const Mat &input_image, Mat &binarized_image, Workspace &workspace) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    binarized_image.create(rows, cols, CV_8U);
+    if (input_image.channels() == 3) cvtColor(input_image, binarized_image, COLOR_RGB2GRAY);
+    else input_image.copyTo(binarized_image);
 
     // Vengono inizializzate le matrici che contengono le statistiche locali dell'immagine. Tali statistiche sono
     // calcolate su una maschera più piccola, chiamata BLOCK, e su una maschera più grande, chiamata CHUNK.
-    auto mean_matrix = new unsigned char*[input_image.size[0]], chunk_mean_matrix = new unsigned char*[input_image.size[0]];
-    auto var_matrix = new float*[input_image.size[0]], chunk_var_matrix = new float*[input_image.size[0]];
-    for (int i=0; i<input_image.size[0]; ++i) {
-        mean_matrix[i] = new unsigned char[input_image.size[1]];
-        chunk_mean_matrix[i] = new unsigned char[input_image.size[1]];
-        var_matrix[i] = new float[input_image.size[1]];
-        chunk_var_matrix[i] = new float[input_image.size[1]];
-    }
+    // Le matrici risiedono nell'arena del workspace, quindi non vengono allocate ad ogni chiamata.
+    Mat chunk_mean_matrix = workspace.matrix(WS_CHUNK_MEAN, rows, cols, CV_8U);
+    Mat chunk_var_matrix = workspace.matrix(WS_CHUNK_VAR, rows, cols, CV_32F);
     int offset = CHUNK_SIZE/2;
-
-    // Vengono calcolate le statistiche locali dell'immagine
-    block_stats(binarized_image, mean_matrix, var_matrix, BLOCK_SIZE);
-    block_stats(binarized_image, chunk_mean_matrix, chunk_var_matrix, CHUNK_SIZE);
+    int correction_offset = CORRECTION_OFFSET;
 
     // Per determinare se un pixel appartiene ad una regione dell'immagine dove è presente del testo, il valore della
     // relativa varianza locale, calcolata all'interno della maschera di dimensione più grande, viene confrontato con
     // la media delle varianze locali calcolate all'interno della maschera più piccola. Se la varianza locale è maggiore
     // della media delle varianze locali, il pixel fa parte di una regione contenente del testo.
-    float var_th = mmean(var_matrix, offset, input_image.size[0]-offset, offset, input_image.size[1]-offset);
+    // Delle statistiche sulla maschera piccola serve solo questa media: quando BLOCK non è più grande di CHUNK,
+    // block_chunk_stats la calcola nella stessa passata delle statistiche su CHUNK, senza salvare le matrici di
+    // medie e varianze su BLOCK.
+    float var_th;
+    if (BLOCK_SIZE <= CHUNK_SIZE) {
+        var_th = block_chunk_stats(binarized_image, chunk_mean_matrix, chunk_var_matrix, BLOCK_SIZE, CHUNK_SIZE);
+    }
+    else {
+        Mat mean_matrix = workspace.matrix(WS_BLOCK_MEAN, rows, cols, CV_8U);
+        Mat var_matrix = workspace.matrix(WS_BLOCK_VAR, rows, cols, CV_32F);
+        parallel_block_stats(binarized_image, mean_matrix, var_matrix, BLOCK_SIZE);
+        parallel_block_stats(binarized_image, chunk_mean_matrix, chunk_var_matrix, CHUNK_SIZE);
+        var_th = mmean(var_matrix, offset, rows-offset, offset, cols-offset);
+    }
 
-    binarized_image.forEach<unsigned char>([input_image, offset, var_th, chunk_mean_matrix, chunk_var_matrix, mean_matrix, var_matrix] (unsigned char &value, const int* position) -> void
+    binarized_image.forEach<unsigned char>([rows, cols, offset, correction_offset, var_th, chunk_mean_matrix, chunk_var_matrix] (unsigned char &value, const int* position) -> void
     {
-        if (position[0] < offset || position[1] < offset || position[0] >= input_image.size[0]-offset || position[1] >= input_image.size[1]-offset) {
+        if (position[0] < offset || position[1] < offset || position[0] >= rows-offset || position[1] >= cols-offset) {
             value = 255;
             return;
         }
 
         int y = position[0], x = position[1];
 
-        if (chunk_var_matrix[y][x] < var_th) {
+        if (chunk_var_matrix.at<float>(y, x) < var_th) {
             value = 255;
         }
         else {
-            value = value > chunk_mean_matrix[y][x] - CORRECTION_OFFSET ? 255 : 0;
+            value = value > chunk_mean_matrix.at<unsigned char>(y, x) - correction_offset ? 255 : 0;
         }
     }
     );
+}
 
-    for (int i=0; i<input_image.size[0]; ++i) {
-        delete[] mean_matrix[i];
-        delete[] chunk_mean_matrix[i];
-        delete[] var_matrix[i];
-        delete[] chunk_var_matrix[i];
+/*
+ La stessa binarizzazione, con le statistiche lette dalle immagini integrali. Il risultato coincide con quello della
+ versione precedente. Quando BLOCK è più grande di CHUNK, la media delle varianze su BLOCK è calcolata sulla regione
+ che dista almeno BLOCK_SIZE/2 dal bordo, dove le maschere sono interamente contenute nell'immagine.
+*/
+
+void StatisticsBasedBinarization::binarize_image(const Mat &input_image, const IntegralStatistics &statistics,
+                                                 Mat &binarized_image) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    if (statistics.rows() != rows || statistics.cols() != cols) {
+        std::cerr<<"binarization.binarize_image(): The statistics do not match the size of the image\n";
+        exit(1);
     }
-    delete[] mean_matrix;
-    delete[] chunk_mean_matrix;
-    delete[] var_matrix;
-    delete[] chunk_var_matrix;
+    binarized_image.create(rows, cols, CV_8U);
+    if (input_image.channels() == 3) cvtColor(input_image, binarized_image, COLOR_RGB2GRAY);
+    else input_image.copyTo(binarized_image);
 
-    return binarized_image;
+    int offset = CHUNK_SIZE/2;
+    int chunk_size = CHUNK_SIZE;
+    int correction_offset = CORRECTION_OFFSET;
+    float var_th = statistics.block_var_mean(BLOCK_SIZE, std::max(offset, BLOCK_SIZE/2));
+
+    binarized_image.forEach<unsigned char>([rows, cols, offset, chunk_size, correction_offset, var_th, &statistics] (unsigned char &value, const int* position) -> void
+    {
+        if (position[0] < offset || position[1] < offset || position[0] >= rows-offset || position[1] >= cols-offset) {
+            value = 255;
+            return;
+        }
+
+        unsigned char chunk_mean;
+        float chunk_var;
+        statistics.block_stats(position[0], position[1], chunk_size, chunk_mean, chunk_var);
+
+        if (chunk_var < var_th) {
+            value = 255;
+        }
+        else {
+            value = value > chunk_mean - correction_offset ? 255 : 0;
+        }
+    }
+    );
+}
+
+// Maschera delle regioni contenenti testo: l'immagine sfocata, i gradienti e la maschera risiedono nel workspace.
+static Mat edge_mask(const Mat &input_image, Workspace &workspace, int blur_kernel_size,
+                     const PreProcessing &edge_params) {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    Mat blurred_image = workspace.matrix(WS_EDGE_BLUR, rows, cols, input_image.type());
+    GaussianBlur(input_image, blurred_image, Size(blur_kernel_size, blur_kernel_size), 0, 0);
+    Mat gradient_image;
+    if (input_image.channels() == 3) gradient_image = workspace.matrix(WS_EDGE_GRADIENT, rows, cols, input_image.type());
+    Mat mask = workspace.matrix(WS_EDGE_MASK, rows, cols, CV_8U);
+    edge_detection(blurred_image, mask, gradient_image, edge_params);
+    return mask;
 }
 
 /*
@@ -89,42 +139,155 @@ completare la binarizzazione, il valore di grigio dei pixel nelle zone che conte
 la media locale, se l'intensità di grigio del pixel è minore della media viene portato a 0, altrimenti a 255. 
 */
 
-Mat FilteringBasedBinarization::binarize_image(const Mat &input_image) {
-    Mat binarized_image = input_image.clone();
-    if (binarized_image.channels() == 3) cvtColor(binarized_image, binarized_image, COLOR_RGB2GRAY);
-    auto mean_matrix = new unsigned char*[input_image.size[0]];
-    for (int i=0; i<input_image.size[0]; ++i) {
-        mean_matrix[i] = new unsigned char[input_image.size[1]];
-        for (int j=0; j<input_image.size[1]; ++j) {
-            mean_matrix[i][j] = 0;
+Mat FilteringBasedBinarization::binarize_image(const Mat &input_image, const PreProcessing &edge_params) const {
+    Workspace workspace;
+    Mat binarized_image;
+    binarize_image(input_image, binarized_image, workspace, edge_params);
+    return binarized_image;
+}
+
+void FilteringBasedBinarization::binarize_image(const Mat &input_image, Mat &binarized_image, Workspace &workspace,
+                                                const PreProcessing &edge_params) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    binarized_image.create(rows, cols, CV_8U);
+    if (input_image.channels() == 3) cvtColor(input_image, binarized_image, COLOR_RGB2GRAY);
+    else input_image.copyTo(binarized_image);
+    Mat mean_matrix = workspace.matrix(WS_BLOCK_MEAN, rows, cols, CV_8U);
+    mean_matrix.setTo(Scalar(0));
+    parallel_block_mean(binarized_image, mean_matrix, BLOCK_SIZE);
+
+    Mat mask = edge_mask(input_image, workspace, BLUR_KERNEL_SIZE, edge_params);
+
+    int offset = BLOCK_SIZE/2;
+    int correction_offset = CORRECTION_OFFSET;
+    binarized_image.forEach<unsigned char>([mask, mean_matrix, offset, correction_offset] (unsigned char &value, const int* p) -> void {
+        int y = p[0], x = p[1];
+        if (y <= offset || x <= offset || y >= mask.size[0] - offset || x >= mask.size[1] - offset) {
+            value = 255;
+            return;
+        }
+
+        if (mask.at<unsigned char>(y, x)) {
+            value = value > mean_matrix.at<unsigned char>(y, x) - correction_offset ? 255 : 0;
+        }
+        else {
+            value = 255;
         }
+    });
+}
+
+void FilteringBasedBinarization::binarize_image(const Mat &input_image, const IntegralStatistics &statistics,
+                                                Mat &binarized_image, Workspace &workspace,
+                                                const PreProcessing &edge_params) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    if (statistics.rows() != rows || statistics.cols() != cols) {
+        std::cerr<<"binarization.binarize_image(): The statistics do not match the size of the image\n";
+        exit(1);
     }
-    block_mean(binarized_image, mean_matrix, BLOCK_SIZE);
+    binarized_image.create(rows, cols, CV_8U);
+    if (input_image.channels() == 3) cvtColor(input_image, binarized_image, COLOR_RGB2GRAY);
+    else input_image.copyTo(binarized_image);
 
-    Mat mask = input_image.clone();
-    GaussianBlur(mask, mask, Size(BLUR_KERNEL_SIZE, BLUR_KERNEL_SIZE), 0, 0);
-    mask = edge_detection(mask);
+    Mat mask = edge_mask(input_image, workspace, BLUR_KERNEL_SIZE, edge_params);
 
-    binarized_image.forEach<unsigned char>([mask, mean_matrix] (unsigned char &value, const int* p) -> void {
+    int offset = BLOCK_SIZE/2;
+    int block_size = BLOCK_SIZE;
+    int correction_offset = CORRECTION_OFFSET;
+    binarized_image.forEach<unsigned char>([mask, offset, block_size, correction_offset, &statistics] (unsigned char &value, const int* p) -> void {
         int y = p[0], x = p[1];
-        if (y <= BLOCK_SIZE/2 || x <= BLOCK_SIZE/2 || y >= mask.size[0] - BLOCK_SIZE/2 || x >= mask.size[1] - BLOCK_SIZE/2) {
+        if (y <= offset || x <= offset || y >= mask.size[0] - offset || x >= mask.size[1] - offset) {
             value = 255;
             return;
         }
 
         if (mask.at<unsigned char>(y, x)) {
-            value = value > mean_matrix[y][x] - CORRECTION_OFFSET ? 255 : 0;
+            value = value > statistics.block_mean(y, x, block_size) - correction_offset ? 255 : 0;
         }
         else {
             value = 255;
         }
     });
+}
 
-    for (int i=0; i<input_image.size[0]; ++i) delete[] mean_matrix[i];
-    delete[] mean_matrix;
-    mask.deallocate();
+/*
+ Le versioni che producono l'immagine ad un bit per pixel applicano la stessa soglia delle precedenti, ma scrivono
+ ogni pixel direttamente nel relativo bit di binarized_image, riga per riga, senza passare per un'immagine ad 8 bit.
+ Se l'immagine di input è a colori, la sua versione in scala di grigio viene calcolata nello slot WS_GREY_IMAGE del
+ workspace; altrimenti viene letta direttamente l'immagine di input.
+*/
 
-    return binarized_image;
+static Mat grey_input_image(const Mat &input_image, Workspace &workspace) {
+    if (input_image.channels() != 3) return input_image;
+    Mat grey_image = workspace.matrix(WS_GREY_IMAGE, input_image.size[0], input_image.size[1], CV_8U);
+    cvtColor(input_image, grey_image, COLOR_RGB2GRAY);
+    return grey_image;
+}
+
+// Riempie binarized_image in parallelo sulle righe: white(y, x) indica se il pixel di coordinate (y, x) è bianco.
+template <typename WhitePixel>
+static void pack_binarized_rows(BilevelImage &binarized_image, const WhitePixel &white) {
+    int cols = binarized_image.cols(), row_bytes = binarized_image.row_bytes();
+    parallel_for_(Range(0, binarized_image.rows()), [&] (const Range &range) -> void {
+        for (int y=range.start; y<range.end; ++y) {
+            unsigned char* packed = binarized_image.row(y);
+            for (int i=0; i<row_bytes; ++i) {
+                unsigned char bits = 0;
+                int last = std::min(cols, 8*i + 8);
+                for (int x=8*i; x<last; ++x) bits |= (unsigned char) (white(y, x) << (7 - (x&7)));
+                packed[i] = bits;
+            }
+        }
+    });
+}
+
+void StatisticsBasedBinarization::binarize_image(const Mat &input_image, BilevelImage &binarized_image,
+                                                 Workspace &workspace) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    Mat grey_image = grey_input_image(input_image, workspace);
+
+    Mat chunk_mean_matrix = workspace.matrix(WS_CHUNK_MEAN, rows, cols, CV_8U);
+    Mat chunk_var_matrix = workspace.matrix(WS_CHUNK_VAR, rows, cols, CV_32F);
+    int offset = CHUNK_SIZE/2;
+    int correction_offset = CORRECTION_OFFSET;
+
+    float var_th;
+    if (BLOCK_SIZE <= CHUNK_SIZE) {
+        var_th = block_chunk_stats(grey_image, chunk_mean_matrix, chunk_var_matrix, BLOCK_SIZE, CHUNK_SIZE);
+    }
+    else {
+        Mat mean_matrix = workspace.matrix(WS_BLOCK_MEAN, rows, cols, CV_8U);
+        Mat var_matrix = workspace.matrix(WS_BLOCK_VAR, rows, cols, CV_32F);
+        parallel_block_stats(grey_image, mean_matrix, var_matrix, BLOCK_SIZE);
+        parallel_block_stats(grey_image, chunk_mean_matrix, chunk_var_matrix, CHUNK_SIZE);
+        var_th = mmean(var_matrix, offset, rows-offset, offset, cols-offset);
+    }
+
+    binarized_image.create(rows, cols);
+    pack_binarized_rows(binarized_image, [&] (int y, int x) -> bool {
+        if (y < offset || x < offset || y >= rows-offset || x >= cols-offset) return true;
+        if (chunk_var_matrix.at<float>(y, x) < var_th) return true;
+        return grey_image.at<unsigned char>(y, x) > chunk_mean_matrix.at<unsigned char>(y, x) - correction_offset;
+    });
+}
+
+void FilteringBasedBinarization::binarize_image(const Mat &input_image, BilevelImage &binarized_image,
+                                                Workspace &workspace, const PreProcessing &edge_params) const {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    Mat grey_image = grey_input_image(input_image, workspace);
+    Mat mean_matrix = workspace.matrix(WS_BLOCK_MEAN, rows, cols, CV_8U);
+    mean_matrix.setTo(Scalar(0));
+    parallel_block_mean(grey_image, mean_matrix, BLOCK_SIZE);
+
+    Mat mask = edge_mask(input_image, workspace, BLUR_KERNEL_SIZE, edge_params);
+
+    int offset = BLOCK_SIZE/2;
+    int correction_offset = CORRECTION_OFFSET;
+    binarized_image.create(rows, cols);
+    pack_binarized_rows(binarized_image, [&] (int y, int x) -> bool {
+        if (y <= offset || x <= offset || y >= rows - offset || x >= cols - offset) return true;
+        if (!mask.at<unsigned char>(y, x)) return true;
+        return grey_image.at<unsigned char>(y, x) > mean_matrix.at<unsigned char>(y, x) - correction_offset;
+    });
 }
 
 StatisticsBasedBinarization::StatisticsBasedBinarization(int block_size, int chunk_size, int correction_offset) {
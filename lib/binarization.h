@@ -1,37 +1,61 @@
 #ifndef SERVER_APP_BINARIZATION_H
 #define SERVER_APP_BINARIZATION_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
+#include "bilevel_image.h"
+#include "pre_processing.h"
+#include "workspace.h"
+#include "integral_statistics.h"
 using namespace cv;
 
 /*
  Questo modulo contiene il codice per effettuare la binarizzazione dell'immagine. Sono presenti due classi, ognuna
  delle quali contiene dei parametri, un costruttore per inizializzarli, ed una funzione binarize_image che realizza
- la binarizzazione dell'immagine.
+ la binarizzazione dell'immagine. binarize_image legge esclusivamente i parametri dell'oggetto su cui è invocata,
+ quindi binarizzazioni con parametri diversi possono essere eseguite in parallelo.
  Le due classi sono rappresentative di due possibili approcci alla binarizzazione, uno basato esclusivamente sull'
  estrazione di statistiche dell'immagine ed uno che sfrutta anche dei filtri passa alto.
 */
 
 class StatisticsBasedBinarization {
 public:
-    static int BLOCK_SIZE;
-    static int CHUNK_SIZE;
-    static int CORRECTION_OFFSET;
+    int BLOCK_SIZE = 9;
+    int CHUNK_SIZE = 37;
+    int CORRECTION_OFFSET = 10;
 
+    StatisticsBasedBinarization() = default;
     explicit StatisticsBasedBinarization(int block_size, int chunk_size, int correction_offset);
-    static Mat binarize_image(const Mat &input_image);
+    Mat binarize_image(const Mat &input_image) const;
+    // Le matrici temporanee sono prese dal workspace e binarized_image viene riallocata solo se le sue dimensioni
+    // cambiano: a regime la funzione non effettua allocazioni. binarized_image non può condividere i dati con
+    // input_image.
+    void binarize_image(const Mat &input_image, Mat &binarized_image, Workspace &workspace) const;
+    // Utilizza le immagini integrali, già calcolate, della versione in scala di grigio di input_image: le statistiche
+    // su BLOCK e CHUNK sono ottenute in tempo costante per ogni pixel, senza altre passate sull'immagine.
+    void binarize_image(const Mat &input_image, const IntegralStatistics &statistics, Mat &binarized_image) const;
+    // Produce l'immagine compressa ad un bit per pixel, scrivendo la soglia direttamente nei bit di ogni riga: non
+    // viene costruita un'immagine binarizzata ad 8 bit, e binarized_image viene riallocata solo se non basta.
+    void binarize_image(const Mat &input_image, BilevelImage &binarized_image, Workspace &workspace) const;
 };
 
 class FilteringBasedBinarization {
 public:
-    static int BLOCK_SIZE;
-    static int CORRECTION_OFFSET;
-    static int BLUR_KERNEL_SIZE;
-    static int THRESHOLD;
+    int BLOCK_SIZE = 19;
+    int CORRECTION_OFFSET = 10;
+    int BLUR_KERNEL_SIZE = 51;
+    int THRESHOLD = 10;
 
+    FilteringBasedBinarization() = default;
     explicit FilteringBasedBinarization(int block_size, int correction_offset, int blur_kernel_size, int threshold,
                                         int hp_kernel_size);
-    static Mat binarize_image(const Mat &input_image);
-};
\ No newline at end of file
+    // La maschera delle regioni contenenti testo è ottenuta tramite edge_detection, con i parametri edge_params.
+    Mat binarize_image(const Mat &input_image, const PreProcessing &edge_params = PreProcessing()) const;
+    void binarize_image(const Mat &input_image, Mat &binarized_image, Workspace &workspace,
+                        const PreProcessing &edge_params = PreProcessing()) const;
+    void binarize_image(const Mat &input_image, const IntegralStatistics &statistics, Mat &binarized_image,
+                        Workspace &workspace, const PreProcessing &edge_params = PreProcessing()) const;
+    void binarize_image(const Mat &input_image, BilevelImage &binarized_image, Workspace &workspace,
+                        const PreProcessing &edge_params = PreProcessing()) const;
+};
+
+#endif
@@ -1,8 +1,6 @@
 #ifndef SERVER_APP_CORNERS_H
 #define SERVER_APP_CORNERS_H
 
-#endif
-
 /*
 Questo modulo contiene il codice per scegliere il candidato migliore tra gli angoli
 ottenuti dall'inseguimento di contorni.
@@ -18,3 +16,5 @@ public:
     void pick_col(CornerCandidate c1, CornerCandidate c2, int (*col_discriminating_func) (int, int));
     void pick_row(CornerCandidate c1, CornerCandidate c2, int (*row_discriminating_func) (int, int));
 };
+
+#endif
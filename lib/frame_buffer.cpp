@@ -0,0 +1,81 @@
+#include "frame_buffer.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+
+using namespace cv;
+
+FrameBuffer::FrameBuffer(const unsigned char* data, int width, int height, size_t stride, int format,
+                         size_t chroma_stride) {
+    DATA = data;
+    WIDTH = width;
+    HEIGHT = height;
+    STRIDE = stride;
+    FORMAT = format;
+    CHROMA_STRIDE = chroma_stride;
+}
+
+static size_t luma_stride(const FrameBuffer &frame) {
+    return frame.STRIDE ? frame.STRIDE : (size_t) frame.WIDTH;
+}
+
+static bool planar(const FrameBuffer &frame) {
+    return frame.FORMAT == FRAME_I420 || frame.FORMAT == FRAME_YV12;
+}
+
+// Byte utilizzati da una riga della crominanza: (WIDTH + 1) / 2 campioni, U e V alternati nei formati semi-planari
+static size_t chroma_row_bytes(const FrameBuffer &frame) {
+    size_t samples = (frame.WIDTH + 1) / 2;
+    return planar(frame) ? samples : 2 * samples;
+}
+
+static size_t chroma_stride(const FrameBuffer &frame) {
+    if (frame.CHROMA_STRIDE) return frame.CHROMA_STRIDE;
+    if (planar(frame)) return (luma_stride(frame) + 1) / 2;
+    return std::max(luma_stride(frame), chroma_row_bytes(frame));
+}
+
+static void check_frame(const FrameBuffer &frame) {
+    if (!frame.DATA) {
+        std::cerr<<"frame_buffer.luma_plane(): The frame buffer is empty\n";
+        exit(1);
+    }
+    if (frame.WIDTH <= 0 || frame.HEIGHT <= 0) {
+        std::cerr<<"frame_buffer.luma_plane(): The frame size must be positive\n";
+        exit(1);
+    }
+    if (luma_stride(frame) < (size_t) frame.WIDTH) {
+        std::cerr<<"frame_buffer.luma_plane(): The stride must be at least as large as the width\n";
+        exit(1);
+    }
+    if (frame.FORMAT < FRAME_GRAY || frame.FORMAT > FRAME_YV12) {
+        std::cerr<<"frame_buffer.luma_plane(): Supported formats are GRAY, NV12, NV21, I420 and YV12\n";
+        exit(1);
+    }
+    if (frame.FORMAT != FRAME_GRAY && chroma_stride(frame) < chroma_row_bytes(frame)) {
+        std::cerr<<"frame_buffer.luma_plane(): The chroma stride is smaller than a chroma row\n";
+        exit(1);
+    }
+}
+
+Mat luma_plane(const FrameBuffer &frame) {
+    check_frame(frame);
+    // Il costruttore di Mat non accetta un puntatore costante, ma la matrice viene solo letta.
+    return Mat(frame.HEIGHT, frame.WIDTH, CV_8U, const_cast<unsigned char*>(frame.DATA), luma_stride(frame));
+}
+
+/*
+ Nei formati 4:2:0 la crominanza ha metà della risoluzione in entrambe le direzioni, arrotondata per eccesso: ogni
+ piano ha (HEIGHT + 1) / 2 righe di (WIDTH + 1) / 2 campioni. Nei formati semi-planari i campioni U e V sono alternati
+ in un unico piano; in quelli planari i due piani si susseguono. Le righe della crominanza distano CHROMA_STRIDE byte,
+ e dell'ultima riga dell'ultimo piano sono richiesti solo i byte utilizzati.
+*/
+
+size_t frame_buffer_size(const FrameBuffer &frame) {
+    check_frame(frame);
+    size_t stride = luma_stride(frame);
+    size_t luma = stride * (frame.HEIGHT - 1) + frame.WIDTH;
+    if (frame.FORMAT == FRAME_GRAY) return luma;
+    size_t chroma_rows = (frame.HEIGHT + 1) / 2;
+    size_t chroma_planes = planar(frame) ? 2 : 1;
+    return stride * frame.HEIGHT + chroma_stride(frame) * (chroma_planes * chroma_rows - 1) + chroma_row_bytes(frame);
+}
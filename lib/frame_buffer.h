@@ -0,0 +1,50 @@
+#ifndef SERVER_APP_FRAME_BUFFER_H
+#define SERVER_APP_FRAME_BUFFER_H
+
+#include "opencv2/opencv.hpp"
+#include <cstddef>
+#define FRAME_GRAY 0
+#define FRAME_NV12 1
+#define FRAME_NV21 2
+#define FRAME_I420 3
+#define FRAME_YV12 4
+using namespace cv;
+
+/*
+ Questo modulo permette di elaborare direttamente i buffer prodotti dalla fotocamera o da un decoder video, senza
+ copiarli e senza convertirli in BGR. Un FrameBuffer descrive un buffer che appartiene al chiamante: un piano di
+ luminanza ad 8 bit (FRAME_GRAY) oppure un fotogramma YUV 4:2:0, semi-planare (FRAME_NV12, FRAME_NV21) o planare
+ (FRAME_I420, FRAME_YV12). In tutti questi formati il piano Y occupa le prime HEIGHT righe del buffer, ciascuna di
+ STRIDE byte, ed è seguito dai piani della crominanza.
+ La pipeline lavora comunque su un solo canale (l'edge detection converte in grigio la somma dei gradienti, e le
+ binarizzazioni l'immagine di input), dunque la crominanza viene ignorata ed il piano Y viene elaborato al posto del
+ grigio ottenuto da BGR. La luminanza Y è una media pesata di R, G e B analoga a quella di COLOR_BGR2GRAY, ma spesso
+ nell'intervallo ridotto 16-235, dunque i risultati sono simili, ma non identici, a quelli dell'immagine convertita.
+ Il buffer non deve essere modificato né liberato finché le matrici restituite da luma_plane sono in uso.
+*/
+
+class FrameBuffer {
+public:
+    const unsigned char* DATA = nullptr;
+    int WIDTH = 0;
+    int HEIGHT = 0;
+    // Byte tra l'inizio di una riga del piano Y e l'inizio della successiva; se vale 0 le righe sono contigue
+    size_t STRIDE = 0;
+    int FORMAT = FRAME_GRAY;
+    // Byte tra l'inizio di una riga della crominanza e l'inizio della successiva. Se vale 0 è pari a STRIDE nei
+    // formati semi-planari (o a 2 x ((WIDTH + 1) / 2), se WIDTH è dispari e le righe sono contigue) ed a
+    // (STRIDE + 1) / 2 in quelli planari, dove i due piani sono consecutivi.
+    size_t CHROMA_STRIDE = 0;
+
+    FrameBuffer() = default;
+    explicit FrameBuffer(const unsigned char* data, int width, int height, size_t stride = 0,
+                         int format = FRAME_GRAY, size_t chroma_stride = 0);
+};
+
+// Restituisce una matrice CV_8U di HEIGHT x WIDTH pixel che punta al piano Y del buffer, senza copiarlo. La matrice non
+// possiede i dati, ed è pensata per essere letta: le funzioni della libreria non modificano mai l'immagine di input.
+Mat luma_plane(const FrameBuffer &frame);
+// Dimensione minima, in byte, di un buffer nel formato indicato, comprese le eventuali righe della crominanza.
+size_t frame_buffer_size(const FrameBuffer &frame);
+
+#endif
@@ -0,0 +1,94 @@
+#include "frame_tracker.h"
+#include "lazy_edge_map.h"
+#include "packed_edge_map.h"
+#include "run_length_index.h"
+#include "opencv2/opencv.hpp"
+#include <memory>
+
+using namespace cv;
+
+FrameTracker::FrameTracker(const PreProcessing &pre_processing, const PageFrame &page_frame) {
+    this->pre_processing = pre_processing;
+    this->page_frame = page_frame;
+}
+
+void FrameTracker::reset() {
+    locked = false;
+}
+
+// Un angolo è confermato quando entrambe le coordinate sono state trovate: la coordinata non trovata si trova
+// all'estremo dell'area di ricerca, e non descrive la posizione della pagina.
+static bool confirmed(const CornerCandidate &candidate) {
+    return candidate.col_confidence && candidate.row_confidence;
+}
+
+/*
+ La ricerca completa coincide con quella di execute_processing_pipeline, ma conserva i 4 angoli, da cui partirà
+ l'inseguimento nei fotogrammi successivi. L'inseguimento inizia solo se abbastanza angoli sono stati confermati su
+ entrambe le coordinate: una coordinata non trovata si trova all'estremo della propria area di ricerca, ed inseguirla
+ non avrebbe senso.
+*/
+
+Rect FrameTracker::full_page_frame(const Mat &frame) {
+    Rect search_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        search_areas[corner] = corner_search_area(frame.size[0], frame.size[1], corner);
+    }
+    if (page_frame.LAZY_EDGE_MAP) {
+        LazyEdgeMap lazy_image(frame, pre_processing);
+        find_corners(lazy_image, search_areas, page_frame, corners);
+    }
+    else if (page_frame.PACKED_EDGE_MAP) {
+        Mat pre_processed_image = pre_process_image(frame, pre_processing);
+        PackedEdgeMap packed_image(pre_processed_image);
+        pre_processed_image.release();
+        find_corners(packed_image, search_areas, page_frame, corners);
+    }
+    else {
+        Mat pre_processed_image = pre_process_image(frame, pre_processing);
+        std::unique_ptr<RunLengthIndex> index;
+        if (page_frame.RUN_LENGTH_INDEX) index.reset(new RunLengthIndex(pre_processed_image));
+        find_corners(pre_processed_image, search_areas, page_frame, corners, index.get());
+    }
+
+    int found_corners = 0;
+    for (const CornerCandidate &candidate : corners) found_corners += confirmed(candidate);
+    locked = found_corners >= MIN_TRACKED_CORNERS;
+    full_search = true;
+    frame_size = Size(frame.size[1], frame.size[0]);
+    return merge_corners(corners);
+}
+
+/*
+ I 4 angoli vengono cercati in parallelo, ciascuno nella propria finestra. Solo le coordinate ritrovate vengono
+ aggiornate: una coordinata non ritrovata resterebbe all'estremo della finestra, e l'angolo si sposterebbe di
+ SEARCH_RADIUS ad ogni fotogramma; mantiene quindi il valore del fotogramma precedente.
+*/
+
+Rect FrameTracker::track(const Mat &frame) {
+    if (!locked || frame.size[0] != frame_size.height || frame.size[1] != frame_size.width) {
+        return full_page_frame(frame);
+    }
+
+    CornerCandidate tracked[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    parallel_for_(Range(0, 4), [&] (const Range &range) -> void {
+        for (int corner=range.start; corner<range.end; ++corner) {
+            tracked[corner] = refine_corner(frame, corner, corners[corner].col, corners[corner].row, SEARCH_RADIUS,
+                                            pre_processing, page_frame);
+        }
+    }, 4);
+
+    int found_corners = 0;
+    for (const CornerCandidate &candidate : tracked) found_corners += confirmed(candidate);
+    if (found_corners < MIN_TRACKED_CORNERS) return full_page_frame(frame);
+
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        if (tracked[corner].col_confidence) corners[corner].col = tracked[corner].col;
+        if (tracked[corner].row_confidence) corners[corner].row = tracked[corner].row;
+    }
+    full_search = false;
+    return merge_corners(corners);
+}
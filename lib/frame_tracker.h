@@ -0,0 +1,55 @@
+#ifndef SERVER_APP_FRAME_TRACKER_H
+#define SERVER_APP_FRAME_TRACKER_H
+
+#include "opencv2/opencv.hpp"
+#include "corners.h"
+#include "page_frame.h"
+#include "pre_processing.h"
+using namespace cv;
+
+/*
+ Questo modulo contiene l'inseguimento della pagina in una sequenza di fotogrammi dello stesso documento, come
+ quelli dell'anteprima della fotocamera o di uno scatto a raffica.
+ Il primo fotogramma viene elaborato con la ricerca completa (pre-processing dell'intera immagine e get_page_frame).
+ Nei fotogrammi successivi ciascun angolo viene cercato solo in una finestra di lato 2 x SEARCH_RADIUS + 1 centrata
+ sulla posizione trovata nel fotogramma precedente, tramite refine_corner: il pre-processing viene eseguito solo su
+ quattro piccoli ritagli, dunque il costo per fotogramma non dipende dalla risoluzione.
+ Se meno di MIN_TRACKED_CORNERS angoli vengono ritrovati su entrambe le coordinate, o se la dimensione del
+ fotogramma cambia, l'inseguimento viene abbandonato e si torna alla ricerca completa.
+ Un FrameTracker mantiene lo stato di una sola sequenza e non deve essere condiviso tra thread diversi.
+*/
+
+class FrameTracker {
+public:
+    int SEARCH_RADIUS = 32;
+    int MIN_TRACKED_CORNERS = 4;
+    PreProcessing pre_processing;
+    PageFrame page_frame;
+
+    FrameTracker() = default;
+    explicit FrameTracker(const PreProcessing &pre_processing, const PageFrame &page_frame);
+
+    // Restituisce il rettangolo che contiene la pagina nel fotogramma, nelle coordinate del fotogramma.
+    Rect track(const Mat &frame);
+    // Dimentica gli angoli trovati: il prossimo fotogramma verrà elaborato con la ricerca completa.
+    void reset();
+
+    // Vero se il prossimo fotogramma verrà elaborato inseguendo gli angoli
+    bool tracking() const { return locked; }
+    // Vero se l'ultima chiamata di track ha eseguito la ricerca completa
+    bool last_full_search() const { return full_search; }
+    const CornerCandidate &corner(int corner) const { return corners[corner]; }
+
+private:
+    Rect full_page_frame(const Mat &frame);
+
+    bool locked = false;
+    bool full_search = false;
+    Size frame_size;
+    CornerCandidate corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "image_statistics.h"
+#include "statistics_kernels.h"
+#include "utility.h"
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
@@ -10,15 +12,15 @@ Sia N x M la dimensione dell'immagine e sia K la lunghezza del lato della masche
 calcolare la media all'interno della maschera per ogni pixel dell'immagine sarebbe un'operazione di 
 complessità O(N x M x K x K). La funzione block_mean invece implementa un algoritmo di complessità
 O(N x M).
+
+Il calcolo vero e proprio è svolto da block_mean_rows, che produce le medie per le righe di output comprese tra
+row_begin e row_end. In questo modo la stessa funzione viene utilizzata sia dalla versione sequenziale, che
+elabora tutte le righe in un'unica fascia, sia da quella parallela, che divide l'immagine in fasce orizzontali.
 */
 
-void block_mean(const Mat &m, unsigned char **mean_matrix, int block_size) {
-    if (!block_size%2) {
-        std::cerr<<"image_statistics.block_mean(): The value of the block size must be an odd number\n";
-        exit(1);
-    }
+static void block_mean_rows(const Mat &m, Mat &mean_matrix, int block_size, int row_begin, int row_end) {
     int offset = block_size/2;
-    int block_area = block_size*block_size;
+    int width = m.size[1];
 
     // Il funzionamento di base dell'algoritmo consiste nel tenere traccia, per ogni colonna,
     // della somma lungo le righe dei valori d'intensità di grigio dei pixel, in una finestra di lunghezza block_size.
@@ -27,49 +29,29 @@ void block_mean(const Mat &m, unsigned char **mean_matrix, int block_size) {
     // maschera. Il vantaggio di questo approccio è che per calcolare la media all'interno della maschera per il pixel
     // nella posizione (i, j), è sufficiente sottrare alla somma calcolata per il pixel nella posizione (i, j-1) il
     // valore della somma lungo le righe in posizione j - 1 - block_size/2, ed aggiungere il valore della somma 
-    // lungo le righe alla posizione j + block_size/2, ed infine dividere per l'area della maschera. 
-    long int block_rows_sum[m.size[1]];
-    for (int i=0; i<m.size[1]; ++i) { // c1 x M operazioni
+    // lungo le righe alla posizione j + block_size/2, ed infine dividere per l'area della maschera.
+    // I cicli interni sono implementati dai kernel di statistics_kernels, che sfruttano le istruzioni vettoriali
+    // della CPU quando disponibili.
+    int32_t block_rows_sum[width];
+    for (int i=0; i<width; ++i) { // c1 x M operazioni
         block_rows_sum[i] = 0;
     }
 
-    // Vengono inizializzati i valori delle somme lungo le righe
-    int gray_value;
-    for (int col=0; col<m.size[1]; col++) { // c2 x M x K operazioni
-        for (int row=0; row<block_size; ++row) {
-            gray_value = m.at<unsigned char>(row, col);
-            block_rows_sum[col] += gray_value;
-        }
+    // Vengono inizializzati i valori delle somme lungo le righe. La finestra iniziale è quella centrata sulla
+    // prima riga della fascia, e comprende le block_size/2 righe che la precedono.
+    for (int row=row_begin-offset; row<=row_begin+offset; ++row) { // c2 x M x K operazioni
+        column_sums_update(nullptr, m.ptr<unsigned char>(row), block_rows_sum, width);
     }
 
-    long int moving_sum; float mean;
-    for (int i=offset; i<m.size[0]-offset; ++i) { // N - K iterazioni
-        if (i!=offset) {
+    for (int i=row_begin; i<row_end; ++i) { // N - K iterazioni
+        if (i!=row_begin) {
             // Ogni volta che si passa alla righa successiva, bisogna aggiornare il valore delle somme lungo
             // le righe.
-            for (int j=0; j<m.size[1]; ++j) { // c3 x M operazioni
-                gray_value = m.at<unsigned char>(i-offset-1, j);
-                block_rows_sum[j] -= gray_value;
-                gray_value = m.at<unsigned char>(i+offset, j);
-                block_rows_sum[j] += gray_value;
-            }
+            column_sums_update(m.ptr<unsigned char>(i-offset-1), m.ptr<unsigned char>(i+offset), block_rows_sum, width); // c3 x M operazioni
         }
 
-        // Il seguente ciclo for consiste in circa c4 x (M - K) + K operazioni
-        for (int j=offset; j<m.size[1]-offset; ++j) { // M - K iterazioni
-            if (j==offset) { // Questo blocco è eseguito 1 volta su M - K iterazioni
-                moving_sum = 0;
-                for (int k=0; k<block_size; ++k) {
-                    moving_sum += block_rows_sum[k];
-                }
-            }
-            else { // c4 operazioni
-                moving_sum -= block_rows_sum[j-offset-1];
-                moving_sum += block_rows_sum[j+offset];
-            }
-            mean = (float) moving_sum / (float) block_area;
-            mean_matrix[i][j] = (unsigned char) mean;
-        }
+        // Il calcolo delle medie lungo la riga consiste in circa c4 x (M - K) + K operazioni
+        window_row_mean(block_rows_sum, block_size, offset, width-offset, mean_matrix.ptr<unsigned char>(i));
     }
 
     // Mettendo tutto insieme, il numero di operazioni effettuato dall'algoritmo è circa
@@ -77,6 +59,16 @@ void block_mean(const Mat &m, unsigned char **mean_matrix, int block_size) {
     // comunque molto più piccolo di M ed N, la complessità dell'algoritmo è O(M x N), e non dipende da K.
 }
 
+void block_mean(const Mat &m, Mat &mean_matrix, int block_size) {
+    if (block_size % 2 == 0) {
+        std::cerr<<"image_statistics.block_mean(): The value of the block size must be an odd number\n";
+        exit(1);
+    }
+    int offset = block_size/2;
+    if (m.size[0] <= 2*offset) return;
+    block_mean_rows(m, mean_matrix, block_size, offset, m.size[0]-offset);
+}
+
 /*
 La seguente funzione per ogni pixel dell'immagine calcola, seguendo lo stesso algoritmo di block_mean, media e varianza
 considerando i valori di grigio dei pixel all'interno di una maschera quadrata centrata nel pixel corrente.
@@ -84,60 +76,177 @@ Per guadagnare in efficienza tramite l'utilizzo delle somme parziali lungo le ri
 var(x) = media(x^2) - (media(x))^2 .
 */
 
-void block_stats(const Mat &m, unsigned char **mean_matrix, float **var_matrix, int block_size) {
-    if (!block_size%2) {
+static void block_stats_rows(const Mat &m, Mat &mean_matrix, Mat &var_matrix, int block_size, int row_begin, int row_end) {
+    int offset = block_size/2;
+    int width = m.size[1];
+
+    int32_t block_rows_sum[width];
+    int32_t block_rows_squares_sum[width];
+    for (int i=0; i<width; ++i) {
+        block_rows_sum[i] = 0;
+        block_rows_squares_sum[i] = 0;
+    }
+    for (int row=row_begin-offset; row<=row_begin+offset; ++row) {
+        column_sums_update(nullptr, m.ptr<unsigned char>(row), block_rows_sum, block_rows_squares_sum, width);
+    }
+
+    for (int i=row_begin; i<row_end; ++i) {
+        if (i!=row_begin) {
+            column_sums_update(m.ptr<unsigned char>(i-offset-1), m.ptr<unsigned char>(i+offset), block_rows_sum,
+                               block_rows_squares_sum, width);
+        }
+        window_row_stats(block_rows_sum, block_rows_squares_sum, block_size, offset, width-offset,
+                         mean_matrix.ptr<unsigned char>(i), var_matrix.ptr<float>(i));
+    }
+}
+
+void block_stats(const Mat &m, Mat &mean_matrix, Mat &var_matrix, int block_size) {
+    if (block_size % 2 == 0) {
         std::cerr<<"image_statistics.block_stats(): The value of the block size must be an odd number\n";
         exit(1);
     }
     int offset = block_size/2;
-    int block_area = block_size*block_size;
+    if (m.size[0] <= 2*offset) return;
+    block_stats_rows(m, mean_matrix, var_matrix, block_size, offset, m.size[0]-offset);
+}
 
-    long int block_rows_sum[m.size[1]];
-    long int block_rows_squares_sum[m.size[1]];
-    for (int i=0; i<m.size[1]; ++i) {
+/*
+Le versioni parallele di block_mean e block_stats dividono le righe di output in fasce orizzontali, elaborate
+contemporaneamente. Ogni fascia inizializza le proprie somme lungo le colonne sulle block_size/2 righe che la
+precedono, dunque le fasce sono del tutto indipendenti ed il risultato coincide bit per bit con quello della versione
+sequenziale. L'inizializzazione costa circa M x K operazioni per fascia, per questo motivo ogni fascia contiene
+almeno block_size righe.
+*/
+
+static int band_count(const Mat &m, int block_size, int bands) {
+    int output_rows = m.size[0] - 2*(block_size/2);
+    if (bands <= 0) bands = getNumThreads();
+    return max(1, min(bands, output_rows / block_size));
+}
+
+void parallel_block_mean(const Mat &m, Mat &mean_matrix, int block_size, int bands) {
+    if (block_size % 2 == 0) {
+        std::cerr<<"image_statistics.parallel_block_mean(): The value of the block size must be an odd number\n";
+        exit(1);
+    }
+    int offset = block_size/2;
+    if (m.size[0] <= 2*offset) return;
+    int row_begin = offset, row_end = m.size[0]-offset;
+    bands = band_count(m, block_size, bands);
+
+    parallel_for_(Range(0, bands), [&] (const Range &range) -> void {
+        for (int band=range.start; band<range.end; ++band) {
+            int band_begin = row_begin + (int) ((long) (row_end-row_begin) * band / bands);
+            int band_end = row_begin + (int) ((long) (row_end-row_begin) * (band+1) / bands);
+            block_mean_rows(m, mean_matrix, block_size, band_begin, band_end);
+        }
+    });
+}
+
+void parallel_block_stats(const Mat &m, Mat &mean_matrix, Mat &var_matrix, int block_size, int bands) {
+    if (block_size % 2 == 0) {
+        std::cerr<<"image_statistics.parallel_block_stats(): The value of the block size must be an odd number\n";
+        exit(1);
+    }
+    int offset = block_size/2;
+    if (m.size[0] <= 2*offset) return;
+    int row_begin = offset, row_end = m.size[0]-offset;
+    bands = band_count(m, block_size, bands);
+
+    parallel_for_(Range(0, bands), [&] (const Range &range) -> void {
+        for (int band=range.start; band<range.end; ++band) {
+            int band_begin = row_begin + (int) ((long) (row_end-row_begin) * band / bands);
+            int band_end = row_begin + (int) ((long) (row_end-row_begin) * (band+1) / bands);
+            block_stats_rows(m, mean_matrix, var_matrix, block_size, band_begin, band_end);
+        }
+    });
+}
+
+/*
+La seguente funzione calcola in un'unica passata sull'immagine le statistiche di cui ha bisogno la binarizzazione
+basata su statistiche: media e varianza sulla maschera grande (chunk), e la media, sulla regione che dista almeno
+chunk_size/2 dal bordo, delle varianze calcolate sulla maschera piccola (block).
+Per ogni riga vengono aggiornate contemporaneamente le somme lungo le colonne relative alle due maschere. Le varianze
+sulla maschera piccola sono calcolate in un buffer grande una sola riga, e sommate immediatamente: non vengono
+quindi mai scritte in memoria né le medie né le varianze sulla maschera piccola.
+Il valore restituito coincide con quello di mmean applicata alla matrice delle varianze calcolata da block_stats,
+perché le medie parziali delle righe sono accumulate nello stesso ordine.
+*/
+
+static void block_chunk_stats_rows(const Mat &m, Mat &chunk_mean_matrix, Mat &chunk_var_matrix, int block_size,
+                                   int chunk_size, int row_begin, int row_end, float* row_var_means) {
+    int block_offset = block_size/2, chunk_offset = chunk_size/2;
+    int width = m.size[1];
+
+    int32_t block_rows_sum[width], block_rows_squares_sum[width];
+    int32_t chunk_rows_sum[width], chunk_rows_squares_sum[width];
+    for (int i=0; i<width; ++i) {
         block_rows_sum[i] = 0;
         block_rows_squares_sum[i] = 0;
+        chunk_rows_sum[i] = 0;
+        chunk_rows_squares_sum[i] = 0;
     }
-    int grey_value;
-    for (int col=0; col<m.size[1]; col++) {
-        for (int row=0; row<block_size; ++row) {
-            grey_value = m.at<unsigned char>(row, col);
-            block_rows_sum[col] += grey_value;
-            block_rows_squares_sum[col] += grey_value*grey_value;
-        }
+    for (int row=row_begin-block_offset; row<=row_begin+block_offset; ++row) {
+        column_sums_update(nullptr, m.ptr<unsigned char>(row), block_rows_sum, block_rows_squares_sum, width);
     }
+    for (int row=row_begin-chunk_offset; row<=row_begin+chunk_offset; ++row) {
+        column_sums_update(nullptr, m.ptr<unsigned char>(row), chunk_rows_sum, chunk_rows_squares_sum, width);
+    }
+
+    // Buffer di una riga per le statistiche sulla maschera piccola
+    unsigned char block_mean_row[width];
+    float block_var_row[width];
+    int x_begin = chunk_offset, x_end = width - chunk_offset;
 
-    long int moving_sum, moving_squares_sum; float mean;
-    for (int i=offset; i<m.size[0]-offset; ++i) {
-        if (i!=offset) {
-            for (int j=0; j<m.size[1]; ++j) {
-                grey_value = m.at<unsigned char>(i-offset-1, j);
-                block_rows_sum[j] -= grey_value;
-                block_rows_squares_sum[j] -= grey_value*grey_value;
-                grey_value = m.at<unsigned char>(i+offset, j);
-                block_rows_sum[j] += grey_value;
-                block_rows_squares_sum[j] += grey_value*grey_value;
-            }
+    float partial_mean;
+    for (int i=row_begin; i<row_end; ++i) {
+        if (i!=row_begin) {
+            column_sums_update(m.ptr<unsigned char>(i-block_offset-1), m.ptr<unsigned char>(i+block_offset),
+                               block_rows_sum, block_rows_squares_sum, width);
+            column_sums_update(m.ptr<unsigned char>(i-chunk_offset-1), m.ptr<unsigned char>(i+chunk_offset),
+                               chunk_rows_sum, chunk_rows_squares_sum, width);
         }
+        window_row_stats(chunk_rows_sum, chunk_rows_squares_sum, chunk_size, x_begin, x_end,
+                         chunk_mean_matrix.ptr<unsigned char>(i), chunk_var_matrix.ptr<float>(i));
+        window_row_stats(block_rows_sum, block_rows_squares_sum, block_size, x_begin, x_end,
+                         block_mean_row, block_var_row);
 
-        for (int j=offset; j<m.size[1]-offset; ++j) {
-            if (j==offset) {
-                moving_sum = 0;
-                moving_squares_sum = 0;
-                for (int k=0; k<block_size; ++k) {
-                    moving_sum += block_rows_sum[k];
-                    moving_squares_sum += block_rows_squares_sum[k];
-                }
-            }
-            else {
-                moving_sum -= block_rows_sum[j-offset-1];
-                moving_sum += block_rows_sum[j+offset];
-                moving_squares_sum -= block_rows_squares_sum[j-offset-1];
-                moving_squares_sum += block_rows_squares_sum[j+offset];
-            }
-            mean = (float) moving_sum / (float) block_area;
-            mean_matrix[i][j] = (unsigned char) mean;
-            var_matrix[i][j] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+        partial_mean = 0;
+        for (int j=x_begin; j<x_end; ++j) {
+            partial_mean += block_var_row[j];
         }
+        row_var_means[i] = partial_mean / (x_end - x_begin);
+    }
+}
+
+float block_chunk_stats(const Mat &m, Mat &chunk_mean_matrix, Mat &chunk_var_matrix, int block_size, int chunk_size,
+                        int bands) {
+    if (block_size % 2 == 0 || chunk_size % 2 == 0) {
+        std::cerr<<"image_statistics.block_chunk_stats(): The value of the block sizes must be odd numbers\n";
+        exit(1);
     }
-}
\ No newline at end of file
+    if (block_size > chunk_size) {
+        std::cerr<<"image_statistics.block_chunk_stats(): The block must not be larger than the chunk\n";
+        exit(1);
+    }
+    int offset = chunk_size/2;
+    if (m.size[0] <= 2*offset || m.size[1] <= 2*offset) return 0;
+    int row_begin = offset, row_end = m.size[0]-offset;
+    bands = band_count(m, chunk_size, bands);
+
+    float row_var_means[m.size[0]];
+    parallel_for_(Range(0, bands), [&] (const Range &range) -> void {
+        for (int band=range.start; band<range.end; ++band) {
+            int band_begin = row_begin + (int) ((long) (row_end-row_begin) * band / bands);
+            int band_end = row_begin + (int) ((long) (row_end-row_begin) * (band+1) / bands);
+            block_chunk_stats_rows(m, chunk_mean_matrix, chunk_var_matrix, block_size, chunk_size, band_begin,
+                                   band_end, row_var_means);
+        }
+    });
+
+    float mean = 0;
+    for (int i=row_begin; i<row_end; ++i) {
+        mean += row_var_means[i];
+    }
+    return mean / (row_end - row_begin);
+}
@@ -1,15 +1,25 @@
 #ifndef SERVER_APP_IMAGE_STATISTICS_H
 #define SERVER_APP_IMAGE_STATISTICS_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
 /*
 Questo modulo contiene il codice per calcolare le statistiche locali di un'immagine. Tali statistiche
 sono utilizzate durante la fase di binarizzazione.
+Le matrici di output devono avere le stesse dimensioni di m, e sono di tipo CV_8U per le medie e CV_32F per le
+varianze. Vengono scritti solo i pixel che distano almeno block_size/2 dal bordo dell'immagine.
 */
 
-void block_mean(const Mat &m, unsigned char **mean_matrix, int block_size);
-void block_stats(const Mat &m, unsigned char **mean_matrix, float **var_matrix, int block_size);
+void block_mean(const Mat &m, Mat &mean_matrix, int block_size);
+void block_stats(const Mat &m, Mat &mean_matrix, Mat &var_matrix, int block_size);
+// Versioni parallele, con risultato identico a quello delle precedenti. Se bands <= 0 il numero di fasce è pari al
+// numero di thread di OpenCV.
+void parallel_block_mean(const Mat &m, Mat &mean_matrix, int block_size, int bands = 0);
+void parallel_block_stats(const Mat &m, Mat &mean_matrix, Mat &var_matrix, int block_size, int bands = 0);
+// Calcola in un'unica passata media e varianza sulla maschera chunk_size e restituisce la media, lontano dal bordo,
+// delle varianze sulla maschera block_size. Le matrici di output sono scritte solo a distanza chunk_size/2 dal bordo.
+float block_chunk_stats(const Mat &m, Mat &chunk_mean_matrix, Mat &chunk_var_matrix, int block_size, int chunk_size,
+                        int bands = 0);
+
+#endif
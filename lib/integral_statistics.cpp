@@ -0,0 +1,124 @@
+#include "integral_statistics.h"
+#include "workspace.h"
+#include "opencv2/opencv.hpp"
+#include <cmath>
+
+using namespace cv;
+
+IntegralStatistics::IntegralStatistics(const Mat &grey_image) {
+    storage.resize(2 * (size_t) (grey_image.size[0]+1) * (grey_image.size[1]+1));
+    build(grey_image, storage.data(), storage.data() + storage.size()/2);
+}
+
+IntegralStatistics::IntegralStatistics(const Mat &grey_image, Workspace &workspace) {
+    size_t bytes = (size_t) (grey_image.size[0]+1) * (grey_image.size[1]+1) * sizeof(int64_t);
+    build(grey_image, (int64_t*) workspace.buffer(WS_INTEGRAL_SUM, bytes),
+          (int64_t*) workspace.buffer(WS_INTEGRAL_SQUARES, bytes));
+}
+
+/*
+ L'immagine integrale I è grande (N+1) x (M+1): I(y, x) è la somma dei pixel nelle righe [0, y) e nelle colonne
+ [0, x), dunque la prima riga e la prima colonna sono nulle. La costruzione avviene in due passate, entrambe parallele:
+ la prima calcola le somme cumulative lungo ciascuna riga, la seconda le accumula lungo le colonne, dividendo
+ l'immagine in fasce verticali.
+ I valori sono a 64 bit: la somma dei quadrati di un'immagine di 48 megapixel supera già i 2^41.
+*/
+
+void IntegralStatistics::build(const Mat &grey_image, int64_t* sum_data, int64_t* squares_data) {
+    if (grey_image.type() != CV_8U) {
+        std::cerr<<"integral_statistics.build(): The image must be a single channel, 8 bit image\n";
+        exit(1);
+    }
+    height = grey_image.size[0];
+    width = grey_image.size[1];
+    stride = width + 1;
+
+    for (size_t x=0; x<stride; ++x) {
+        sum_data[x] = 0;
+        squares_data[x] = 0;
+    }
+
+    parallel_for_(Range(0, height), [&] (const Range &range) -> void {
+        for (int y=range.start; y<range.end; ++y) {
+            const unsigned char* row = grey_image.ptr<unsigned char>(y);
+            int64_t* sum_row = sum_data + (y+1)*stride;
+            int64_t* squares_row = squares_data + (y+1)*stride;
+            int64_t row_sum = 0, row_squares_sum = 0;
+            sum_row[0] = 0;
+            squares_row[0] = 0;
+            for (int x=0; x<width; ++x) {
+                row_sum += row[x];
+                row_squares_sum += row[x]*row[x];
+                sum_row[x+1] = row_sum;
+                squares_row[x+1] = row_squares_sum;
+            }
+        }
+    });
+
+    // Le fasce verticali sono larghe almeno 64 colonne, in modo che ogni thread legga intere linee di cache
+    int strips = std::max(1, std::min(getNumThreads(), (int) stride / 64));
+    parallel_for_(Range(0, strips), [&] (const Range &range) -> void {
+        for (int strip=range.start; strip<range.end; ++strip) {
+            size_t x_begin = stride * strip / strips, x_end = stride * (strip+1) / strips;
+            for (int y=2; y<=height; ++y) {
+                int64_t* sum_row = sum_data + y*stride;
+                int64_t* squares_row = squares_data + y*stride;
+                for (size_t x=x_begin; x<x_end; ++x) {
+                    sum_row[x] += sum_row[x - stride];
+                    squares_row[x] += squares_row[x - stride];
+                }
+            }
+        }
+    });
+
+    sums = sum_data;
+    squares_sums = squares_data;
+}
+
+float IntegralStatistics::mean(int y_low, int y_high, int x_low, int x_high) const {
+    return (float) ((double) sum(y_low, y_high, x_low, x_high) / ((double) (y_high-y_low) * (x_high-x_low)));
+}
+
+float IntegralStatistics::variance(int y_low, int y_high, int x_low, int x_high) const {
+    double area = (double) (y_high-y_low) * (x_high-x_low);
+    double region_mean = (double) sum(y_low, y_high, x_low, x_high) / area;
+    return (float) ((double) squares_sum(y_low, y_high, x_low, x_high) / area - region_mean*region_mean);
+}
+
+float IntegralStatistics::stddev(int y_low, int y_high, int x_low, int x_high) const {
+    return std::sqrt(std::max(0.0f, variance(y_low, y_high, x_low, x_high)));
+}
+
+/*
+ Le medie parziali delle righe sono calcolate in parallelo, ma sommate in ordine di riga come fa mmean, in modo che il
+ risultato non dipenda dal numero di thread.
+*/
+
+float IntegralStatistics::block_var_mean(int block_size, int border) const {
+    if (border < block_size/2) {
+        std::cerr<<"integral_statistics.block_var_mean(): The border must not be smaller than block_size/2\n";
+        exit(1);
+    }
+    if (height <= 2*border || width <= 2*border) return 0;
+    int y_low = border, y_high = height - border, x_low = border, x_high = width - border;
+
+    std::vector<float> row_var_means(height);
+    parallel_for_(Range(y_low, y_high), [&] (const Range &range) -> void {
+        unsigned char block_mean_value;
+        float block_var_value, partial_mean;
+        for (int y=range.start; y<range.end; ++y) {
+            partial_mean = 0;
+            for (int x=x_low; x<x_high; ++x) {
+                block_stats(y, x, block_size, block_mean_value, block_var_value);
+                partial_mean += block_var_value;
+            }
+            row_var_means[y] = partial_mean / (x_high - x_low);
+        }
+    });
+
+    float mean = 0;
+    for (int y=y_low; y<y_high; ++y) {
+        mean += row_var_means[y];
+    }
+    return mean / (y_high - y_low);
+}
@@ -0,0 +1,79 @@
+#ifndef SERVER_APP_INTEGRAL_STATISTICS_H
+#define SERVER_APP_INTEGRAL_STATISTICS_H
+
+#include "opencv2/opencv.hpp"
+#include "workspace.h"
+#include <cstdint>
+#include <vector>
+using namespace cv;
+
+/*
+ Questo modulo contiene un motore di statistiche basato sulle immagini integrali. A partire da un'immagine in scala di
+ grigio vengono costruite, una sola volta, le immagini integrali dei valori e dei loro quadrati, a 64 bit. Dopodiché
+ la somma, la media e la varianza di una qualsiasi regione rettangolare si ottengono con quattro accessi in memoria,
+ indipendentemente dalla dimensione della regione.
+ In questo modo più metodi di binarizzazione a soglia locale, ciascuno con le proprie maschere, possono condividere
+ un'unica pre-elaborazione della pagina, invece di ripetere ognuno le proprie passate sull'immagine.
+
+ Le regioni sono indicate come nel resto del progetto: righe in [y_low, y_high) e colonne in [x_low, x_high).
+ Le statistiche sulle maschere quadrate coincidono esattamente con quelle calcolate da block_stats.
+*/
+
+class IntegralStatistics {
+public:
+    IntegralStatistics() = default;
+    IntegralStatistics(const IntegralStatistics &) = delete;
+    IntegralStatistics &operator=(const IntegralStatistics &) = delete;
+    explicit IntegralStatistics(const Mat &grey_image);
+    // Le immagini integrali sono allocate negli slot WS_INTEGRAL_SUM e WS_INTEGRAL_SQUARES del workspace, e sono
+    // valide finché tali slot non vengono riutilizzati.
+    IntegralStatistics(const Mat &grey_image, Workspace &workspace);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+
+    int64_t sum(int y_low, int y_high, int x_low, int x_high) const {
+        return area_sum(sums, y_low, y_high, x_low, x_high);
+    }
+    int64_t squares_sum(int y_low, int y_high, int x_low, int x_high) const {
+        return area_sum(squares_sums, y_low, y_high, x_low, x_high);
+    }
+    // Equivalenti di mmean, mvar e mstddev, calcolati però in tempo costante.
+    float mean(int y_low, int y_high, int x_low, int x_high) const;
+    float variance(int y_low, int y_high, int x_low, int x_high) const;
+    float stddev(int y_low, int y_high, int x_low, int x_high) const;
+
+    // Media e varianza della maschera di lato block_size centrata in (y, x), con le stesse operazioni di block_stats.
+    // La maschera deve essere interamente contenuta nell'immagine.
+    unsigned char block_mean(int y, int x, int block_size) const {
+        int offset = block_size/2;
+        return (unsigned char) ((float) sum(y-offset, y+offset+1, x-offset, x+offset+1) / (float) (block_size*block_size));
+    }
+    void block_stats(int y, int x, int block_size, unsigned char &mean, float &var) const {
+        int offset = block_size/2;
+        float block_area = (float) (block_size*block_size);
+        float float_mean = (float) sum(y-offset, y+offset+1, x-offset, x+offset+1) / block_area;
+        mean = (unsigned char) float_mean;
+        var = ((float) squares_sum(y-offset, y+offset+1, x-offset, x+offset+1) / block_area) - float_mean*float_mean;
+    }
+
+    // Media, sulla regione che dista almeno border dal bordo, delle varianze calcolate sulla maschera di lato
+    // block_size. Coincide con mmean applicata alla matrice delle varianze di block_stats. Deve valere
+    // border >= block_size/2.
+    float block_var_mean(int block_size, int border) const;
+
+private:
+    int height = 0, width = 0;
+    size_t stride = 0;
+    const int64_t* sums = nullptr;
+    const int64_t* squares_sums = nullptr;
+    std::vector<int64_t> storage;
+
+    void build(const Mat &grey_image, int64_t* sum_data, int64_t* squares_data);
+    int64_t area_sum(const int64_t* integral, int y_low, int y_high, int x_low, int x_high) const {
+        return integral[y_high*stride + x_high] - integral[y_low*stride + x_high]
+             - integral[y_high*stride + x_low] + integral[y_low*stride + x_low];
+    }
+};
+
+#endif
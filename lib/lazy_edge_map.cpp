@@ -0,0 +1,113 @@
+#include "lazy_edge_map.h"
+#include "page_frame.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+
+using namespace cv;
+
+/*
+ Il valore di un pixel dell'immagine filtrata dipende dai pixel di input entro il raggio del passa-basso, sommato a
+ quello del passa-alto ed a quello del filtro mediano: è questo il margine del ritaglio su cui viene calcolato ciascun
+ tassello.
+*/
+
+LazyEdgeMap::LazyEdgeMap(const Mat &input_image, const PreProcessing &params) {
+    if (input_image.depth() != CV_8U) {
+        std::cerr<<"lazy_edge_map.LazyEdgeMap(): The image must be an 8 bit image\n";
+        exit(1);
+    }
+    this->input_image = input_image;
+    this->params = params;
+    height = input_image.size[0];
+    width = input_image.size[1];
+    tile_rows = (height + tile_mask) >> LAZY_TILE_SHIFT;
+    tile_cols = (width + tile_mask) >> LAZY_TILE_SHIFT;
+    halo = 2*(params.BLUR_KERNEL_SIZE/2) + params.HP_KERNEL_SIZE/2;
+    tiles.resize((size_t) tile_rows * tile_cols);
+    tile_flags.reset(new std::once_flag[tiles.size()]);
+}
+
+void LazyEdgeMap::compute_tile(int tile_row, int tile_col) const {
+    Rect image_area(0, 0, width, height);
+    Rect tile_area = Rect(tile_col << LAZY_TILE_SHIFT, tile_row << LAZY_TILE_SHIFT, tile_mask + 1, tile_mask + 1)
+                     & image_area;
+    Rect crop = Rect(tile_area.x - halo, tile_area.y - halo, tile_area.width + 2*halo, tile_area.height + 2*halo)
+                & image_area;
+    Mat filtered = pre_process_image(input_image(crop), params);
+    // La copia libera la memoria del margine, che non serve più.
+    tiles[(size_t) tile_row*tile_cols + tile_col] =
+            filtered(Rect(tile_area.x - crop.x, tile_area.y - crop.y, tile_area.width, tile_area.height)).clone();
+    ++computed;
+}
+
+const Mat &LazyEdgeMap::tile(int tile_row, int tile_col) const {
+    size_t i = (size_t) tile_row*tile_cols + tile_col;
+    std::call_once(tile_flags[i], [&] () { compute_tile(tile_row, tile_col); });
+    return tiles[i];
+}
+
+/*
+ La ricerca del primo pixel bianco procede un tassello alla volta: all'interno di un tassello i pixel della riga (o
+ della colonna) vengono letti direttamente dalla matrice, senza passare per at().
+*/
+
+int LazyEdgeMap::next_white_in_row(int row, int from, int end, int step) const {
+    if (row < 0 || row >= height) return -1;
+    for (int col=from; col!=end;) {
+        if (col < 0 || col >= width) return -1;
+        int tile_col = col >> LAZY_TILE_SHIFT;
+        const unsigned char* pixels = tile(row >> LAZY_TILE_SHIFT, tile_col).ptr<unsigned char>(row & tile_mask);
+        int tile_x = tile_col << LAZY_TILE_SHIFT;
+        int segment_end = step > 0 ? std::min(end, std::min(tile_x + tile_mask + 1, width))
+                                   : std::max(end, tile_x - 1);
+        for (; col!=segment_end; col+=step) {
+            if (pixels[col - tile_x]) return col;
+        }
+    }
+    return -1;
+}
+
+int LazyEdgeMap::next_white_in_column(int col, int from, int end, int step) const {
+    if (col < 0 || col >= width) return -1;
+    for (int row=from; row!=end;) {
+        if (row < 0 || row >= height) return -1;
+        int tile_row = row >> LAZY_TILE_SHIFT;
+        const Mat &tile_image = tile(tile_row, col >> LAZY_TILE_SHIFT);
+        int tile_y = tile_row << LAZY_TILE_SHIFT;
+        int segment_end = step > 0 ? std::min(end, std::min(tile_y + tile_mask + 1, height))
+                                   : std::max(end, tile_y - 1);
+        for (; row!=segment_end; row+=step) {
+            if (tile_image.at<unsigned char>(row - tile_y, col & tile_mask)) return row;
+        }
+    }
+    return -1;
+}
+
+int LazyEdgeMap::run_length(int row, int col, int direction, int max_length) const {
+    int row_step, col_step;
+    switch (direction) {
+        case W_E: row_step = 0; col_step = 1; break;
+        case E_W: row_step = 0; col_step = -1; break;
+        case N_S: row_step = 1; col_step = 0; break;
+        case S_N: row_step = -1; col_step = 0; break;
+        default:
+            std::cerr<<"lazy_edge_map.run_length(): Possible directions are West -> East, East -> West, North -> South, South -> North\n";
+            exit(1);
+    }
+    int run = 0;
+    for (; run < max_length && at(row, col); row+=row_step, col+=col_step) ++run;
+    return run;
+}
+
+Mat LazyEdgeMap::materialize() const {
+    Mat filtered_image(height, width, CV_8U);
+    parallel_for_(Range(0, tile_count()), [&] (const Range &range) -> void {
+        for (int i=range.start; i<range.end; ++i) {
+            int tile_row = i / tile_cols, tile_col = i % tile_cols;
+            const Mat &tile_image = tile(tile_row, tile_col);
+            tile_image.copyTo(filtered_image(Rect(tile_col << LAZY_TILE_SHIFT, tile_row << LAZY_TILE_SHIFT,
+                                                  tile_image.size[1], tile_image.size[0])));
+        }
+    });
+    return filtered_image;
+}
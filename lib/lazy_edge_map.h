@@ -0,0 +1,71 @@
+#ifndef SERVER_APP_LAZY_EDGE_MAP_H
+#define SERVER_APP_LAZY_EDGE_MAP_H
+
+#include "opencv2/opencv.hpp"
+#include "pre_processing.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#define LAZY_TILE_SHIFT 8
+using namespace cv;
+
+/*
+ Questo modulo contiene l'immagine filtrata prodotta dal pre-processing, calcolata in modo pigro. L'immagine è divisa
+ in tasselli di 2^LAZY_TILE_SHIFT x 2^LAZY_TILE_SHIFT pixel, ed un tassello viene calcolato solo la prima volta che la
+ ricerca degli angoli ne legge un pixel: pre_process_image viene eseguita sul ritaglio dell'immagine di input che
+ contiene il tassello ed un margine pari al raggio complessivo dei filtri (mediano, passa-alto e passa-basso), e del
+ risultato si conserva solo il tassello. Il margine garantisce che ogni tassello coincida con la porzione
+ corrispondente di pre_process_image applicata all'intera immagine; ai bordi dell'immagine il ritaglio è limitato
+ dall'immagine stessa, che viene estesa dai filtri come di consueto.
+ Poiché la ricerca di ciascun angolo si arresta al primo candidato accettato, di solito vengono calcolati solo i
+ tasselli vicini ai bordi dell'immagine, e l'interno della pagina non viene mai elaborato.
+ I tasselli possono essere richiesti da più thread contemporaneamente: ciascuno viene calcolato una sola volta.
+ L'immagine di input viene condivisa, e non copiata: non deve essere modificata finché il LazyEdgeMap è in uso.
+*/
+
+class LazyEdgeMap {
+public:
+    LazyEdgeMap(const Mat &input_image, const PreProcessing &params = PreProcessing());
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    bool contains(int row, int col) const {
+        return row >= 0 && col >= 0 && row < height && col < width;
+    }
+    bool at(int row, int col) const {
+        if (!contains(row, col)) return false;
+        const Mat &tile_image = tile(row >> LAZY_TILE_SHIFT, col >> LAZY_TILE_SHIFT);
+        return tile_image.at<unsigned char>(row & tile_mask, col & tile_mask) != 0;
+    }
+
+    // Primo pixel bianco della riga (o della colonna), partendo da from e procedendo di step (1 o -1) fino ad end
+    // escluso. Restituisce -1 se non ce ne sono. Come per PackedEdgeMap.
+    int next_white_in_row(int row, int from, int end, int step) const;
+    int next_white_in_column(int col, int from, int end, int step) const;
+    // Numero di pixel bianchi consecutivi a partire da (row, col), compreso, nella direzione W_E, E_W, N_S o S_N. Il
+    // conteggio si arresta dopo max_length pixel, in modo da non calcolare tasselli oltre quelli necessari.
+    int run_length(int row, int col, int direction, int max_length) const;
+
+    // Numero di tasselli calcolati finora, e numero totale di tasselli
+    int computed_tiles() const { return computed; }
+    int tile_count() const { return tile_rows * tile_cols; }
+    // L'immagine filtrata completa, ottenuta calcolando tutti i tasselli mancanti
+    Mat materialize() const;
+
+private:
+    const Mat &tile(int tile_row, int tile_col) const;
+    void compute_tile(int tile_row, int tile_col) const;
+
+    Mat input_image;
+    PreProcessing params;
+    int height = 0, width = 0;
+    int tile_rows = 0, tile_cols = 0;
+    int tile_mask = (1 << LAZY_TILE_SHIFT) - 1;
+    int halo = 0;
+    mutable std::vector<Mat> tiles;
+    mutable std::unique_ptr<std::once_flag[]> tile_flags;
+    mutable std::atomic<int> computed{0};
+};
+
+#endif
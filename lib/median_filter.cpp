@@ -0,0 +1,146 @@
+#include "median_filter.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace cv;
+
+/*
+ Per ogni colonna viene mantenuto l'istogramma dei K pixel della colonna che cadono nella maschera centrata sulla riga
+ corrente. Passando alla riga successiva ogni istogramma di colonna viene aggiornato togliendo un pixel ed
+ aggiungendone uno. L'istogramma della maschera è la somma dei K istogrammi di colonna che essa contiene: passando al
+ pixel successivo lungo la riga si somma l'istogramma della colonna che entra e si sottrae quello della colonna che
+ esce. Il costo per pixel è quindi costante, qualunque sia K.
+
+ Gli istogrammi sono a due livelli: 16 contenitori grossolani (i 4 bit più significativi) e 256 contenitori fini.
+ L'istogramma grossolano della maschera viene aggiornato ad ogni pixel. Quello fine viene aggiornato solo nel
+ contenitore grossolano che contiene la mediana, e soltanto quando serve: last_update tiene traccia dell'ultima
+ colonna sommata per ciascun contenitore, in modo da recuperare solo le colonne mancanti, o di ricalcolarlo da zero
+ se sono trascorse più di K colonne.
+
+ Il tassello copre le colonne di output [x_begin, x_end) e le righe [y_begin, y_end). Gli istogrammi di colonna
+ coprono le colonne estese [x_begin - K/2, x_end + K/2), i cui indici fuori dall'immagine sono ricondotti al bordo,
+ come con BORDER_REPLICATE.
+*/
+
+static void median_filter_tile(const Mat &input_image, Mat &output_image, int kernel_size, int channel,
+                               int x_begin, int x_end, int y_begin, int y_end) {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    int channels = input_image.channels();
+    int offset = kernel_size/2;
+    int extended_width = x_end - x_begin + 2*offset;
+    int rank = kernel_size*kernel_size/2;
+
+    std::vector<uint16_t> column_coarse((size_t) extended_width*16), column_fine((size_t) extended_width*256);
+    std::vector<int> source_column(extended_width);
+    for (int e=0; e<extended_width; ++e) {
+        source_column[e] = std::min(std::max(x_begin - offset + e, 0), cols-1)*channels + channel;
+    }
+
+    for (int d=-offset; d<=offset; ++d) {
+        const unsigned char* row = input_image.ptr<unsigned char>(std::min(std::max(y_begin + d, 0), rows-1));
+        for (int e=0; e<extended_width; ++e) {
+            unsigned char value = row[source_column[e]];
+            column_coarse[e*16 + (value>>4)]++;
+            column_fine[e*256 + value]++;
+        }
+    }
+
+    uint32_t coarse[16], fine[256];
+    int last_update[16];
+    for (int y=y_begin; y<y_end; ++y) {
+        if (y != y_begin) {
+            const unsigned char* outgoing = input_image.ptr<unsigned char>(std::max(y - offset - 1, 0));
+            const unsigned char* incoming = input_image.ptr<unsigned char>(std::min(y + offset, rows-1));
+            for (int e=0; e<extended_width; ++e) {
+                unsigned char old_value = outgoing[source_column[e]], new_value = incoming[source_column[e]];
+                column_coarse[e*16 + (old_value>>4)]--;
+                column_fine[e*256 + old_value]--;
+                column_coarse[e*16 + (new_value>>4)]++;
+                column_fine[e*256 + new_value]++;
+            }
+        }
+
+        // Gli istogrammi della maschera vengono ricostruiti all'inizio di ogni riga
+        memset(coarse, 0, sizeof(coarse));
+        for (int e=0; e<kernel_size; ++e) {
+            for (int b=0; b<16; ++b) coarse[b] += column_coarse[e*16 + b];
+        }
+        for (int b=0; b<16; ++b) last_update[b] = 0;
+
+        unsigned char* output = output_image.ptr<unsigned char>(y);
+        for (int i=0; i<x_end-x_begin; ++i) {
+            // La maschera del pixel i copre le colonne estese [i, i + kernel_size)
+            if (i != 0) {
+                const uint16_t* incoming = &column_coarse[(i + kernel_size - 1)*16];
+                const uint16_t* outgoing = &column_coarse[(i - 1)*16];
+                for (int b=0; b<16; ++b) coarse[b] += incoming[b] - outgoing[b];
+            }
+
+            int count = 0, bin = 0;
+            while (count + (int) coarse[bin] <= rank) count += coarse[bin++];
+
+            uint32_t* bin_fine = &fine[bin*16];
+            if (last_update[bin] <= i) {
+                memset(bin_fine, 0, 16*sizeof(uint32_t));
+                for (int e=i; e<i+kernel_size; ++e) {
+                    const uint16_t* column = &column_fine[e*256 + bin*16];
+                    for (int v=0; v<16; ++v) bin_fine[v] += column[v];
+                }
+            }
+            else {
+                for (int e=last_update[bin]; e<i+kernel_size; ++e) {
+                    const uint16_t* incoming = &column_fine[e*256 + bin*16];
+                    const uint16_t* outgoing = &column_fine[(e - kernel_size)*256 + bin*16];
+                    for (int v=0; v<16; ++v) bin_fine[v] += incoming[v] - outgoing[v];
+                }
+            }
+            last_update[bin] = i + kernel_size;
+
+            int value = 0;
+            while (count + (int) bin_fine[value] <= rank) count += bin_fine[value++];
+            output[(x_begin + i)*channels + channel] = (unsigned char) (bin*16 + value);
+        }
+    }
+}
+
+void median_filter(const Mat &input_image, Mat &output_image, int kernel_size, int tile_width) {
+    if (input_image.depth() != CV_8U) {
+        std::cerr<<"median_filter.median_filter(): The image must be an 8 bit image\n";
+        exit(1);
+    }
+    if (kernel_size < 1 || !(kernel_size%2)) {
+        std::cerr<<"median_filter.median_filter(): The kernel size must be an odd positive number\n";
+        exit(1);
+    }
+    // Il filtro non può essere calcolato sul posto: se input ed output coincidono viene fatta una copia dell'input
+    Mat source = input_image.data == output_image.data ? input_image.clone() : input_image;
+    output_image.create(source.size[0], source.size[1], source.type());
+    if (kernel_size == 1) {
+        source.copyTo(output_image);
+        return;
+    }
+
+    int rows = source.size[0], cols = source.size[1], channels = source.channels();
+    if (tile_width <= 0) tile_width = MEDIAN_TILE_WIDTH;
+
+    // I tasselli sono fasce verticali di larghezza tile_width, divise a loro volta in fasce orizzontali in modo da
+    // avere lavoro per tutti i thread. Ogni tassello inizializza i propri istogrammi con K righe, quindi le fasce
+    // orizzontali sono alte almeno 4 x K righe.
+    int strips = (cols + tile_width - 1) / tile_width;
+    int bands = std::max(1, std::min((getNumThreads() + strips - 1) / strips, rows / (4*kernel_size)));
+    int tiles = strips * bands * channels;
+
+    parallel_for_(Range(0, tiles), [&] (const Range &range) -> void {
+        for (int tile=range.start; tile<range.end; ++tile) {
+            int channel = tile % channels;
+            int strip = tile / channels % strips;
+            int band = tile / channels / strips;
+            int x_begin = strip*tile_width, x_end = std::min(x_begin + tile_width, cols);
+            int y_begin = (int) ((long) rows * band / bands), y_end = (int) ((long) rows * (band+1) / bands);
+            median_filter_tile(source, output_image, kernel_size, channel, x_begin, x_end, y_begin, y_end);
+        }
+    });
+}
@@ -0,0 +1,20 @@
+#ifndef SERVER_APP_MEDIAN_FILTER_H
+#define SERVER_APP_MEDIAN_FILTER_H
+
+#include "opencv2/opencv.hpp"
+using namespace cv;
+
+/*
+ Questo modulo contiene un filtro mediano per immagini ad 8 bit il cui costo per pixel non dipende dalla dimensione
+ della maschera, basato sugli istogrammi delle colonne (Perreault ed Hébert, "Median Filtering in Constant Time").
+ Il risultato coincide con quello di medianBlur: ogni canale è filtrato separatamente, ed ai bordi l'immagine è
+ estesa replicando i pixel di bordo.
+ L'immagine è divisa in tasselli che vengono elaborati in parallelo; tile_width è la larghezza dei tasselli, e se
+ non è positiva viene utilizzato un valore adatto a mantenere gli istogrammi nella cache.
+*/
+
+#define MEDIAN_TILE_WIDTH 256
+
+void median_filter(const Mat &input_image, Mat &output_image, int kernel_size, int tile_width = 0);
+
+#endif
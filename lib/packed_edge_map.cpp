@@ -0,0 +1,117 @@
+#include "packed_edge_map.h"
+#include "page_frame.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+
+using namespace cv;
+
+/*
+ La rappresentazione per righe viene costruita in parallelo riga per riga. Quella per colonne è la trasposta: l'
+ immagine viene divisa in fasce verticali, ed ogni thread percorre tutte le righe impostando i bit delle proprie
+ colonne, in modo che thread diversi non scrivano mai nella stessa parola.
+*/
+
+PackedEdgeMap::PackedEdgeMap(const Mat &edge_image) {
+    if (edge_image.type() != CV_8U) {
+        std::cerr<<"packed_edge_map.PackedEdgeMap(): The edge map must be a single channel, 8 bit image\n";
+        exit(1);
+    }
+    height = edge_image.size[0];
+    width = edge_image.size[1];
+    row_words = (width + 63) / 64;
+    column_words = (height + 63) / 64;
+    row_bits.assign((size_t) height * row_words, 0);
+    column_bits.assign((size_t) width * column_words, 0);
+
+    parallel_for_(Range(0, height), [&] (const Range &range) -> void {
+        for (int row=range.start; row<range.end; ++row) {
+            const unsigned char* pixels = edge_image.ptr<unsigned char>(row);
+            uint64_t* line = &row_bits[(size_t) row*row_words];
+            for (int col=0; col<width; ++col) {
+                line[col>>6] |= (uint64_t) (pixels[col] != 0) << (col&63);
+            }
+        }
+    });
+
+    int strips = std::max(1, std::min(getNumThreads(), width / 64));
+    parallel_for_(Range(0, strips), [&] (const Range &range) -> void {
+        for (int strip=range.start; strip<range.end; ++strip) {
+            int col_begin = (int) ((long) width * strip / strips), col_end = (int) ((long) width * (strip+1) / strips);
+            for (int row=0; row<height; ++row) {
+                const unsigned char* pixels = edge_image.ptr<unsigned char>(row);
+                uint64_t bit = (uint64_t) 1 << (row&63);
+                for (int col=col_begin; col<col_end; ++col) {
+                    if (pixels[col]) column_bits[(size_t) col*column_words + (row>>6)] |= bit;
+                }
+            }
+        }
+    });
+}
+
+int PackedEdgeMap::next_set_bit(const uint64_t* line, int size, int from, int end, int step) {
+    if (step > 0) {
+        from = std::max(from, 0);
+        end = std::min(end, size);
+        for (int position=from; position<end; ) {
+            int word = position >> 6;
+            uint64_t bits = line[word] & (~(uint64_t) 0 << (position&63));
+            if (bits) {
+                int found = word*64 + __builtin_ctzll(bits);
+                return found < end ? found : -1;
+            }
+            position = (word+1) * 64;
+        }
+    }
+    else {
+        from = std::min(from, size-1);
+        end = std::max(end, -1);
+        for (int position=from; position>end; ) {
+            int word = position >> 6;
+            int offset = position & 63;
+            uint64_t bits = line[word] & (offset == 63 ? ~(uint64_t) 0 : ((uint64_t) 1 << (offset+1)) - 1);
+            if (bits) {
+                int found = word*64 + 63 - __builtin_clzll(bits);
+                return found > end ? found : -1;
+            }
+            position = word*64 - 1;
+        }
+    }
+    return -1;
+}
+
+int PackedEdgeMap::set_bits_run(const uint64_t* line, int size, int from, int step) {
+    if (from < 0 || from >= size) return 0;
+    int run = 0;
+    if (step > 0) {
+        // La sequenza si interrompe al primo bit nullo, o alla fine della linea.
+        for (int position=from; position<size; ) {
+            int offset = position & 63;
+            uint64_t holes = ~line[position >> 6] >> offset;
+            if (holes) return run + __builtin_ctzll(holes);
+            run += 64 - offset;
+            position += 64 - offset;
+        }
+        return run;
+    }
+    for (int position=from; position>=0; ) {
+        int offset = position & 63;
+        uint64_t holes = ~line[position >> 6] << (63 - offset);
+        if (holes) return run + __builtin_clzll(holes);
+        run += offset + 1;
+        position -= offset + 1;
+    }
+    return run;
+}
+
+int PackedEdgeMap::run_length(int row, int col, int direction) const {
+    if (!contains(row, col)) return 0;
+    switch (direction) {
+        case W_E: return set_bits_run(row_line(row), width, col, 1);
+        case E_W: return set_bits_run(row_line(row), width, col, -1);
+        case N_S: return set_bits_run(column_line(col), height, row, 1);
+        case S_N: return set_bits_run(column_line(col), height, row, -1);
+        default:
+            std::cerr<<"packed_edge_map.run_length(): Possible directions are West -> East, East -> West, North -> South, South -> North\n";
+            exit(1);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SERVER_APP_PACKED_EDGE_MAP_H
+#define SERVER_APP_PACKED_EDGE_MAP_H
+
+#include "opencv2/opencv.hpp"
+#include <cstdint>
+#include <vector>
+using namespace cv;
+
+/*
+ Questo modulo contiene una rappresentazione ad un bit per pixel dell'immagine filtrata prodotta dal pre-processing,
+ che contiene solo i valori 0 e 255. L'immagine è memorizzata due volte: per righe, con 64 pixel consecutivi di una
+ riga in ogni parola, e per colonne, con 64 pixel consecutivi di una colonna in ogni parola. Anche così occupa un
+ quarto della memoria dell'immagine ad 8 bit.
+ Con questa rappresentazione la ricerca del primo pixel bianco lungo una riga o una colonna esamina 64 pixel alla
+ volta tramite count-trailing-zeros, e la verifica di una sequenza ininterrotta di pixel bianchi in 64 posizioni
+ consecutive diventa l'AND di parole a 64 bit.
+ I bit oltre l'ultima colonna (o riga) di ciascuna linea sono sempre nulli, ed i pixel fuori dall'immagine sono neri.
+*/
+
+class PackedEdgeMap {
+public:
+    PackedEdgeMap() = default;
+    // I pixel non nulli di edge_image, che deve essere di tipo CV_8U, sono bianchi.
+    explicit PackedEdgeMap(const Mat &edge_image);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    bool contains(int row, int col) const {
+        return row >= 0 && col >= 0 && row < height && col < width;
+    }
+    bool at(int row, int col) const {
+        if (!contains(row, col)) return false;
+        return (row_bits[(size_t) row*row_words + (col>>6)] >> (col&63)) & 1;
+    }
+
+    // Le linee della rappresentazione per righe (di width bit) e per colonne (di height bit)
+    const uint64_t* row_line(int row) const { return &row_bits[(size_t) row*row_words]; }
+    const uint64_t* column_line(int col) const { return &column_bits[(size_t) col*column_words]; }
+    int row_line_words() const { return row_words; }
+
+    // Primo pixel bianco della riga (o della colonna), partendo da from e procedendo di step (1 o -1) fino ad end
+    // escluso. Restituisce -1 se non ce ne sono.
+    int next_white_in_row(int row, int from, int end, int step) const {
+        return next_set_bit(row_line(row), width, from, end, step);
+    }
+    int next_white_in_column(int col, int from, int end, int step) const {
+        return next_set_bit(column_line(col), height, from, end, step);
+    }
+    // Numero di pixel bianchi consecutivi a partire da (row, col), compreso, nella direzione W_E, E_W, N_S o S_N.
+    int run_length(int row, int col, int direction) const;
+
+    static int next_set_bit(const uint64_t* line, int size, int from, int end, int step);
+    static int set_bits_run(const uint64_t* line, int size, int from, int step);
+
+private:
+    int height = 0, width = 0;
+    int row_words = 0, column_words = 0;
+    std::vector<uint64_t> row_bits, column_bits;
+};
+
+#endif
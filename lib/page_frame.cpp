@@ -2,13 +2,16 @@
 #include "opencv2/opencv.hpp"
 #include "utility.h"
 #include "corners.h"
+#include "run_length_index.h"
+#include "packed_edge_map.h"
+#include "lazy_edge_map.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 using namespace cv;
 
-int PageFrame::CHASE_DEPTH = 400;
-int PageFrame::RUDIMENTARY_DEPTH = 200;
-int PageFrame::MAX_ADJUSTMENTS = 6;
-double PageFrame::TANGENT_TABLE[] = {
+const double PageFrame::TANGENT_TABLE[] = {
         -0.268, // tan(-15°)
         -0.176, // tan(-10°)
         -0.087, // tan(-5°)
@@ -17,6 +20,105 @@ double PageFrame::TANGENT_TABLE[] = {
         0.268, // tan(15°)
 };
 
+const int PageFrame::TANGENT_TABLE_MILLI[] = {-268, -176, -87, 87, 176, 268};
+
+/*
+ edge_chase e la ricerca degli angoli sono scritte una sola volta, come template, per le tre rappresentazioni
+ dell'immagine filtrata: la matrice ad 8 bit, il PackedEdgeMap ed il LazyEdgeMap. Le seguenti funzioni sono gli accessi
+ all'immagine che dipendono dalla rappresentazione. Con il PackedEdgeMap la lunghezza delle sequenze di pixel bianchi
+ orizzontali e verticali è calcolata direttamente dai bit, 64 pixel alla volta, dunque non serve un RunLengthIndex.
+ Con il LazyEdgeMap la lunghezza è calcolata leggendo i tasselli, e si arresta dopo max_length pixel: calcolarla per
+ intero richiederebbe di calcolare tasselli che l'inseguimento non leggerebbe.
+*/
+
+static inline unsigned char edge_pixel(const Mat &image, int row, int col) {
+    return image.at<unsigned char>(row, col);
+}
+
+static inline unsigned char edge_pixel(const PackedEdgeMap &image, int row, int col) {
+    return image.at(row, col) ? 255 : 0;
+}
+
+static inline unsigned char edge_pixel(const LazyEdgeMap &image, int row, int col) {
+    return image.at(row, col) ? 255 : 0;
+}
+
+static inline bool edge_contains(const Mat &image, int row, int col) {
+    return row >= 0 && col >= 0 && row < image.size[0] && col < image.size[1];
+}
+
+static inline bool edge_contains(const PackedEdgeMap &image, int row, int col) {
+    return image.contains(row, col);
+}
+
+static inline bool edge_contains(const LazyEdgeMap &image, int row, int col) {
+    return image.contains(row, col);
+}
+
+static inline bool has_straight_runs(const Mat &/*image*/, const RunLengthIndex *index) {
+    return index != nullptr;
+}
+
+static inline bool has_straight_runs(const PackedEdgeMap &/*image*/, const RunLengthIndex */*index*/) {
+    return true;
+}
+
+static inline bool has_straight_runs(const LazyEdgeMap &/*image*/, const RunLengthIndex */*index*/) {
+    return true;
+}
+
+static inline int straight_run(const Mat &/*image*/, const RunLengthIndex *index, int row, int col, int direction,
+                               int /*max_length*/) {
+    return index->run_length(row, col, direction);
+}
+
+static inline int straight_run(const PackedEdgeMap &image, const RunLengthIndex */*index*/, int row, int col,
+                               int direction, int /*max_length*/) {
+    return image.run_length(row, col, direction);
+}
+
+static inline int straight_run(const LazyEdgeMap &image, const RunLengthIndex */*index*/, int row, int col,
+                               int direction, int max_length) {
+    return image.run_length(row, col, direction, max_length);
+}
+
+// Restituisce il primo j in [j, count) tale che il pixel in posizione first + j x step della riga (o della colonna)
+// line sia bianco, oppure count se non ce ne sono.
+static inline int next_white(const Mat &image, bool along_row, int line, int first, int step, int j, int count) {
+    if (along_row) {
+        const unsigned char* pixels = image.ptr<unsigned char>(line);
+        while (j < count && !pixels[first + j*step]) ++j;
+    }
+    else {
+        while (j < count && !image.at<unsigned char>(first + j*step, line)) ++j;
+    }
+    return j;
+}
+
+static inline int next_white(const PackedEdgeMap &image, bool along_row, int line, int first, int step, int j, int count) {
+    int position = along_row ? image.next_white_in_row(line, first + j*step, first + count*step, step)
+                             : image.next_white_in_column(line, first + j*step, first + count*step, step);
+    return position < 0 ? count : (position - first) * step;
+}
+
+static inline int next_white(const LazyEdgeMap &image, bool along_row, int line, int first, int step, int j, int count) {
+    int position = along_row ? image.next_white_in_row(line, first + j*step, first + count*step, step)
+                             : image.next_white_in_column(line, first + j*step, first + count*step, step);
+    return position < 0 ? count : (position - first) * step;
+}
+
+template <class EdgeImage>
+static bool chase_edge(const EdgeImage &image, int row, int col, int chase_direction, const PageFrame &params,
+                       const RunLengthIndex *index, long &visited);
+
+// Se PageFrame::CHASE_COUNTERS non è nullo, ogni passata della ricerca degli angoli vi aggiunge, al termine, il numero
+// di chiamate di edge_chase ed il numero di pixel letti.
+static void count_chases(const PageFrame &params, long calls, long visited) {
+    if (!params.CHASE_COUNTERS) return;
+    params.CHASE_COUNTERS->calls += calls;
+    params.CHASE_COUNTERS->pixels += visited;
+}
+
 /*
  Questa funzione estrae il rettangolo contenente il foglio da scannerizzare ricercandone i 4 angoli.
  Per esempio, per ricercare l'angolo in alto a sinista, l'immagine viene attraversata partendo dal pixel nella
@@ -32,146 +134,203 @@ double PageFrame::TANGENT_TABLE[] = {
  Tramite un procedimento analogo vengono ricercati gli angoli in basso a sinistra, in basso a destra ed in alto a destra.
 */
 
-Rect get_page_frame(const Mat &filtered_image) {
+Rect get_page_frame(const Mat &filtered_image, const PageFrame &params) {
     // La ricerca degli angoli si arresta a metà dell'immagine, sotto l'ipotesi che il foglio da scannerizare si trovi
     // a cavallo, almeno in parte, dei quattro quadranti dell'immagine.
-    int margin_search_x_bound = filtered_image.size[1] / 2;
-    int margin_search_y_bound = filtered_image.size[0] / 2;
-
-    // Vegono inizializzati i candidati per i 4 angoli dell'immagine
-    CornerCandidate TL_corner(0, 0, false, false);
-    CornerCandidate TR_corner(filtered_image.size[1] - 1, 0, false, false);
-    CornerCandidate BL_corner(0, filtered_image.size[0] - 1, false, false);
-    CornerCandidate BR_corner(filtered_image.size[1] - 1, filtered_image.size[0] - 1, false, false);
-
-    // Vengono inizializzati i candidati per gli angoli trovati attraversando l'immagine in diretzione
-    // Nord -> Sud e Ovest -> Est
-    CornerCandidate X_corner(0, 0, false, false);
-    CornerCandidate Y_corner(0, 0, false, false);
-    bool found_margin = false;
-
-    // Ricerca dell'angolo in alto a sinistra. Prima l'immagine viene attraversata in direzione Ovest -> Est, poi in
-    // direzione Nord -> Sud. Quando l'immagine è attraversata da Ovest ad Est, la linea di pixel bianchi ricercata
-    // va dall'alto verso il basso, mentre quando l'immagine è attraversata da Nord a Sud va da sinistra a destra.
-    for (int row=0; row<margin_search_y_bound && !found_margin; ++row) {
-        for (int col=0; col<margin_search_x_bound && !found_margin; ++col) {
-            if (edge_chase(filtered_image, row, col, N_S)) {
-                X_corner.row = row;
-                X_corner.col = col;
-                X_corner.row_confidence = false;
-                X_corner.col_confidence = true;
-                found_margin = true;
-            }
-        }
-    }
-    found_margin = false;
-    for (int col=0; col<margin_search_x_bound && !found_margin; ++col) {
-        for (int row=0; row<margin_search_y_bound && !found_margin; ++row) {
-            if (edge_chase(filtered_image, row, col, W_E)) {
-                Y_corner.row = row;
-                Y_corner.col = col;
-                Y_corner.row_confidence = true;
-                Y_corner.col_confidence = false;
-                found_margin = true;
-            }
-        }
-    }
-    // I candidati ottenuti vengono confrontati per determinare l'angolo in alto a sinistra.
-    TL_corner.pick_col(X_corner, Y_corner, min);
-    TL_corner.pick_row(X_corner, Y_corner, min);
-
-    // Ricerca dell'angolo in alto a destra.
-    X_corner.init(filtered_image.size[1] - 1, 0, false, false);
-    Y_corner.init(filtered_image.size[1] - 1, 0, false, false);
-    found_margin = false;
-    for (int row=0; row<margin_search_y_bound && !found_margin; ++row) {
-        for (int col=filtered_image.size[1]-1; col>=filtered_image.size[1]-margin_search_x_bound && !found_margin; --col) {
-            if (edge_chase(filtered_image, row, col, N_S)) {
-                X_corner.row = row;
-                X_corner.col = col;
-                X_corner.row_confidence = false;
-                X_corner.col_confidence = true;
-                found_margin = true;
-            }
-        }
+    // L'indice delle sequenze di pixel bianchi è condiviso dalla ricerca dei 4 angoli.
+    std::unique_ptr<RunLengthIndex> index;
+    if (params.RUN_LENGTH_INDEX) index.reset(new RunLengthIndex(filtered_image));
+    Rect search_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        search_areas[corner] = corner_search_area(filtered_image, corner);
     }
-    found_margin = false;
-    for (int col=filtered_image.size[1]-1; col>=filtered_image.size[1]-margin_search_x_bound && !found_margin; --col) {
-        for (int row=0; row<margin_search_y_bound && !found_margin; ++row) {
-            if (edge_chase(filtered_image, row, col, E_W)) {
-                Y_corner.row = row;
-                Y_corner.col = col;
-                Y_corner.row_confidence = true;
-                Y_corner.col_confidence = false;
-                found_margin = true;
-            }
-        }
+    CornerCandidate corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    find_corners(filtered_image, search_areas, params, corners, index.get());
+    return merge_corners(corners);
+}
+
+// La stessa ricerca sull'immagine filtrata compressa ad un bit per pixel. Le sequenze di pixel bianchi orizzontali e
+// verticali sono lette direttamente dai bit, dunque non viene costruito il RunLengthIndex.
+Rect get_page_frame(const PackedEdgeMap &filtered_image, const PageFrame &params) {
+    Rect search_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        search_areas[corner] = corner_search_area(filtered_image.rows(), filtered_image.cols(), corner);
     }
-    // Confronto dei candidati
-    TR_corner.pick_col(X_corner, Y_corner, max);
-    TR_corner.pick_row(X_corner, Y_corner, min);
-
-    // Ricerca dell'angolo in basso a sinistra
-    X_corner.init(0, filtered_image.size[0] - 1, false, false);
-    Y_corner.init(0, filtered_image.size[0] - 1, false, false);
-    found_margin = false;
-    for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0]-margin_search_y_bound && !found_margin; --row) {
-        for (int col=0; col<margin_search_x_bound && !found_margin; ++col) {
-            if (edge_chase(filtered_image, row, col, S_N)) {
-                X_corner.row = row;
-                X_corner.col = col;
-                X_corner.row_confidence = false;
-                X_corner.col_confidence = true;
-                found_margin = true;
-            }
-        }
+    CornerCandidate corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    find_corners(filtered_image, search_areas, params, corners);
+    return merge_corners(corners);
+}
+
+// La stessa ricerca sull'immagine filtrata calcolata a tasselli: vengono pre-processati solo i tasselli letti.
+Rect get_page_frame(const LazyEdgeMap &filtered_image, const PageFrame &params) {
+    Rect search_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        search_areas[corner] = corner_search_area(filtered_image.rows(), filtered_image.cols(), corner);
     }
-    found_margin = false;
-    for (int col=0; col<margin_search_x_bound && !found_margin; ++col) {
-        for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0]-margin_search_y_bound && !found_margin; --row) {
-            if (edge_chase(filtered_image, row, col, W_E)) {
-                Y_corner.row = row;
-                Y_corner.col = col;
-                Y_corner.row_confidence = true;
-                Y_corner.col_confidence = false;
-                found_margin = true;
+    CornerCandidate corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    find_corners(filtered_image, search_areas, params, corners);
+    return merge_corners(corners);
+}
+
+Rect corner_search_area(const Mat &filtered_image, int corner) {
+    return corner_search_area(filtered_image.size[0], filtered_image.size[1], corner);
+}
+
+Rect corner_search_area(int rows, int cols, int corner) {
+    int margin_search_x_bound = cols / 2;
+    int margin_search_y_bound = rows / 2;
+    int x = corner == TL_CORNER || corner == BL_CORNER ? 0 : cols - margin_search_x_bound;
+    int y = corner == TL_CORNER || corner == TR_CORNER ? 0 : rows - margin_search_y_bound;
+    return {x, y, margin_search_x_bound, margin_search_y_bound};
+}
+
+/*
+ Una passata della ricerca di un angolo. Se rows_first è vero l'area viene attraversata riga per riga, partendo dalla
+ riga più vicina al bordo dell'immagine, alla ricerca di una linea verticale diretta verso l'interno: il candidato
+ trovato determina con sicurezza la colonna dell'angolo. Altrimenti l'area viene attraversata colonna per colonna,
+ alla ricerca di una linea orizzontale, ed il candidato determina con sicurezza la riga.
+ Se non viene trovato nessun candidato, viene restituito l'estremo dell'area senza alcuna sicurezza.
+*/
+
+template <class EdgeImage>
+static CornerCandidate search_pass(const EdgeImage &filtered_image, int corner, bool rows_first, const Rect &search_area,
+                                   const PageFrame &params, const RunLengthIndex *index) {
+    bool top = corner == TL_CORNER || corner == TR_CORNER;
+    bool left = corner == TL_CORNER || corner == BL_CORNER;
+    int first_row = top ? search_area.y : search_area.y + search_area.height - 1;
+    int first_col = left ? search_area.x : search_area.x + search_area.width - 1;
+    int row_step = top ? 1 : -1, col_step = left ? 1 : -1;
+
+    CornerCandidate candidate(first_col, first_row, false, false);
+    long calls = 0, visited = 0;
+    if (rows_first) {
+        int chase_direction = top ? N_S : S_N;
+        for (int i=0; i<search_area.height; ++i) {
+            int row = first_row + i*row_step;
+            // edge_chase fallisce subito sui pixel neri: si salta direttamente al prossimo pixel bianco della riga.
+            for (int j=0; j<search_area.width; ++j) {
+                j = next_white(filtered_image, true, row, first_col, col_step, j, search_area.width);
+                if (j == search_area.width) break;
+                int col = first_col + j*col_step;
+                ++calls;
+                if (chase_edge(filtered_image, row, col, chase_direction, params, index, visited)) {
+                    candidate.init(col, row, true, false);
+                    count_chases(params, calls, visited);
+                    return candidate;
+                }
             }
         }
     }
-    // Confronto dei candidati
-    BL_corner.pick_col(X_corner, Y_corner, min);
-    BL_corner.pick_row(X_corner, Y_corner, max);
-
-    // Ricerca dell'angolo in basso a destra
-    X_corner.init(filtered_image.size[1] - 1, filtered_image.size[0] - 1, false, false);
-    Y_corner.init(filtered_image.size[1] - 1, filtered_image.size[0] - 1, false, false);
-    found_margin = false;
-    for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0]-margin_search_y_bound && !found_margin; --row) {
-        for (int col=filtered_image.size[1]-1; col>=filtered_image.size[1]-margin_search_x_bound && !found_margin; --col) {
-            if (edge_chase(filtered_image, row, col, S_N)) {
-                X_corner.row = row;
-                X_corner.col = col;
-                X_corner.row_confidence = false;
-                X_corner.col_confidence = true;
-                found_margin = true;
+    else {
+        int chase_direction = left ? W_E : E_W;
+        for (int j=0; j<search_area.width; ++j) {
+            int col = first_col + j*col_step;
+            for (int i=0; i<search_area.height; ++i) {
+                i = next_white(filtered_image, false, col, first_row, row_step, i, search_area.height);
+                if (i == search_area.height) break;
+                int row = first_row + i*row_step;
+                ++calls;
+                if (chase_edge(filtered_image, row, col, chase_direction, params, index, visited)) {
+                    candidate.init(col, row, false, true);
+                    count_chases(params, calls, visited);
+                    return candidate;
+                }
             }
         }
     }
-    found_margin = false;
-    for (int col=filtered_image.size[1]-1; col>=filtered_image.size[1]-margin_search_x_bound && !found_margin; --col) {
-        for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0]-margin_search_y_bound && !found_margin; --row) {
-            if (edge_chase(filtered_image, row, col, E_W)) {
-                Y_corner.row = row;
-                Y_corner.col = col;
-                Y_corner.row_confidence = true;
-                Y_corner.col_confidence = false;
-                found_margin = true;
-            }
+    count_chases(params, calls, visited);
+    return candidate;
+}
+
+CornerCandidate corner_search_pass(const Mat &filtered_image, int corner, bool rows_first, const Rect &search_area,
+                                   const PageFrame &params, const RunLengthIndex *index) {
+    return search_pass(filtered_image, corner, rows_first, search_area, params, index);
+}
+
+/*
+ I candidati ottenuti dalle due passate vengono confrontati per determinare l'angolo: per l'angolo in alto a sinistra
+ si sceglie la colonna minima e la riga minima, per quello in basso a destra la colonna massima e la riga massima,
+ e così via.
+*/
+
+CornerCandidate pick_corner(int corner, const CornerCandidate &X_corner, const CornerCandidate &Y_corner,
+                            const Rect &search_area) {
+    bool top = corner == TL_CORNER || corner == TR_CORNER;
+    bool left = corner == TL_CORNER || corner == BL_CORNER;
+    int (*pick_min) (int, int) = min;
+    int (*pick_max) (int, int) = max;
+
+    CornerCandidate best(left ? search_area.x : search_area.x + search_area.width - 1,
+                         top ? search_area.y : search_area.y + search_area.height - 1, false, false);
+    best.pick_col(X_corner, Y_corner, left ? pick_min : pick_max);
+    best.pick_row(X_corner, Y_corner, top ? pick_min : pick_max);
+    return best;
+}
+
+CornerCandidate find_corner(const Mat &filtered_image, int corner, const Rect &search_area, const PageFrame &params,
+                            const RunLengthIndex *index) {
+    // Quando l'immagine è attraversata riga per riga, la linea di pixel bianchi ricercata è verticale, mentre
+    // quando è attraversata colonna per colonna è orizzontale.
+    CornerCandidate X_corner = corner_search_pass(filtered_image, corner, true, search_area, params, index);
+    CornerCandidate Y_corner = corner_search_pass(filtered_image, corner, false, search_area, params, index);
+    return pick_corner(corner, X_corner, Y_corner, search_area);
+}
+
+/*
+ Le 8 passate della ricerca dei 4 angoli (una per riga ed una per colonna per ciascun angolo) sono tra loro
+ indipendenti: leggono l'immagine filtrata e l'indice, e non condividono nessuno stato. Vengono quindi eseguite come
+ task concorrenti, ed i candidati sono confrontati tramite pick_corner solo al termine di tutte le passate.
+ Il risultato coincide con quello di find_corner applicata ai 4 angoli uno dopo l'altro.
+*/
+
+template <class EdgeImage>
+static void search_corners(const EdgeImage &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                           CornerCandidate corners[4], const RunLengthIndex *index) {
+    CornerCandidate candidates[8] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    parallel_for_(Range(0, 8), [&] (const Range &range) -> void {
+        for (int pass=range.start; pass<range.end; ++pass) {
+            int corner = pass / 2;
+            candidates[pass] = search_pass(filtered_image, corner, pass % 2 == 0, search_areas[corner], params, index);
         }
+    }, 8);
+
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        corners[corner] = pick_corner(corner, candidates[2*corner], candidates[2*corner + 1], search_areas[corner]);
     }
-    // Confronto dei candidati
-    BR_corner.pick_col(X_corner, Y_corner, max);
-    BR_corner.pick_row(X_corner, Y_corner, max);
+}
+
+void find_corners(const Mat &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4], const RunLengthIndex *index) {
+    search_corners(filtered_image, search_areas, params, corners, index);
+}
+
+void find_corners(const PackedEdgeMap &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4]) {
+    search_corners(filtered_image, search_areas, params, corners, nullptr);
+}
+
+void find_corners(const LazyEdgeMap &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4]) {
+    search_corners(filtered_image, search_areas, params, corners, nullptr);
+}
+
+Rect merge_corners(const CornerCandidate corners[4]) {
+    CornerCandidate TL_corner = corners[TL_CORNER], TR_corner = corners[TR_CORNER];
+    CornerCandidate BL_corner = corners[BL_CORNER], BR_corner = corners[BR_CORNER];
 
     // I 4 angoli ottenuti descrivono un parallelogramma che non necessariamente ha lati perfettamente orizzontali
     // o perfettamente verticali. Dunque gli angoli vengono confrontati per costruire un rettangolo 
@@ -187,127 +346,226 @@ Rect get_page_frame(const Mat &filtered_image) {
     return {TL_corner.col, TL_corner.row, width, height};
 }
 
+/*
+ La ricerca multi-risoluzione. L'immagine di input viene ridotta di un fattore S = 2^PYRAMID_LEVEL, ed il
+ pre-processing e la ricerca degli angoli vengono eseguiti sull'immagine ridotta, con maschere e profondità di
+ inseguimento divise per S. Il costo di questa fase dipende dunque da N x M / S^2.
+ Ciascun angolo trovato viene poi riportato a piena risoluzione e rifinito: il pre-processing viene ripetuto solo
+ su un ritaglio dell'immagine di input attorno all'angolo, e l'angolo viene cercato in una finestra di lato
+ 2 x REFINE_RADIUS x S centrata sulla sua posizione approssimata. Il ritaglio si estende verso l'interno della pagina
+ per CHASE_DEPTH pixel, in modo che edge_chase possa percorrere i contorni alla profondità consueta, lateralmente
+ di quanto si spostano le rette inclinate di 15°, e da ogni lato di un margine che contiene le maschere dei filtri.
+ Se l'angolo non viene trovato a piena risoluzione, viene mantenuta la posizione approssimata.
+*/
+
+#define REFINE_RADIUS 4
+
+/*
+ Cerca l'angolo corner dell'immagine di input nella finestra di lato 2 x radius + 1 centrata in (row, col), eseguendo
+ il pre-processing solo sul ritaglio descritto sopra. Il candidato restituito è espresso nelle coordinate di
+ input_image; se l'angolo non viene trovato nessuna delle due confidenze è impostata.
+*/
+
+CornerCandidate refine_corner(const Mat &input_image, int corner, int col, int row, int radius,
+                              const PreProcessing &pre_processing, const PageFrame &params) {
+    bool top = corner == TL_CORNER || corner == TR_CORNER;
+    bool left = corner == TL_CORNER || corner == BL_CORNER;
+    int context = pre_processing.BLUR_KERNEL_SIZE + pre_processing.HP_KERNEL_SIZE/2;
+    int slant = (int) (PageFrame::TANGENT_TABLE[5] * params.CHASE_DEPTH) + 1;
+    Rect image_area(0, 0, input_image.size[1], input_image.size[0]);
+
+    Rect window = Rect(col - radius, row - radius, 2*radius + 1, 2*radius + 1) & image_area;
+    if (window.width <= 0 || window.height <= 0) return CornerCandidate(col, row, false, false);
+    int crop_x = window.x - (left ? slant : params.CHASE_DEPTH + slant) - context;
+    int crop_y = window.y - (top ? slant : params.CHASE_DEPTH + slant) - context;
+    int crop_width = window.width + params.CHASE_DEPTH + 2*slant + 2*context;
+    int crop_height = window.height + params.CHASE_DEPTH + 2*slant + 2*context;
+    Rect crop = Rect(crop_x, crop_y, crop_width, crop_height) & image_area;
+
+    Mat fine_filtered = pre_process_image(input_image(crop), pre_processing);
+    Rect local_window(window.x - crop.x, window.y - crop.y, window.width, window.height);
+    std::unique_ptr<RunLengthIndex> fine_index;
+    if (params.RUN_LENGTH_INDEX) fine_index.reset(new RunLengthIndex(fine_filtered));
+    CornerCandidate fine = find_corner(fine_filtered, corner, local_window, params, fine_index.get());
+    fine.init(fine.col + crop.x, fine.row + crop.y, fine.col_confidence, fine.row_confidence);
+    return fine;
+}
+
+Rect coarse_to_fine_page_frame(const Mat &input_image, const PreProcessing &pre_processing, const PageFrame &params) {
+    int scale = 1 << std::max(params.PYRAMID_LEVEL, 0);
+    int rows = input_image.size[0], cols = input_image.size[1];
+    if (scale == 1 || rows/scale < 16 || cols/scale < 16) {
+        return get_page_frame(pre_process_image(input_image, pre_processing), params);
+    }
+
+    // Parametri scalati per il livello ridotto. Le maschere dei filtri devono restare di lato dispari.
+    PreProcessing coarse_pre_processing = pre_processing;
+    coarse_pre_processing.BLUR_KERNEL_SIZE = std::max(pre_processing.BLUR_KERNEL_SIZE / scale, 3) | 1;
+    coarse_pre_processing.HP_KERNEL_SIZE = std::max(pre_processing.HP_KERNEL_SIZE / scale, 3) | 1;
+    PageFrame coarse_params = params;
+    coarse_params.CHASE_DEPTH = std::max(params.CHASE_DEPTH / scale, 4);
+    coarse_params.RUDIMENTARY_DEPTH = std::max(params.RUDIMENTARY_DEPTH / scale, 4);
+
+    Mat coarse_image;
+    resize(input_image, coarse_image, Size(cols/scale, rows/scale), 0, 0, INTER_AREA);
+    Mat coarse_filtered = pre_process_image(coarse_image, coarse_pre_processing);
+    std::unique_ptr<RunLengthIndex> coarse_index;
+    if (params.RUN_LENGTH_INDEX) coarse_index.reset(new RunLengthIndex(coarse_filtered));
+
+    int radius = REFINE_RADIUS * scale;
+
+    CornerCandidate corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    CornerCandidate coarse_corners[4] = {
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+            CornerCandidate(0, 0, false, false), CornerCandidate(0, 0, false, false),
+    };
+    Rect coarse_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        coarse_areas[corner] = corner_search_area(coarse_filtered, corner);
+    }
+    find_corners(coarse_filtered, coarse_areas, coarse_params, coarse_corners, coarse_index.get());
+
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        bool top = corner == TL_CORNER || corner == TR_CORNER;
+        bool left = corner == TL_CORNER || corner == BL_CORNER;
+        const CornerCandidate &coarse = coarse_corners[corner];
+
+        // Posizione approssimata a piena risoluzione. Gli estremi dell'immagine ridotta corrispondono agli estremi
+        // dell'immagine di input.
+        int col = coarse.col == coarse_filtered.size[1]-1 ? cols-1 : coarse.col*scale + scale/2;
+        int row = coarse.row == coarse_filtered.size[0]-1 ? rows-1 : coarse.row*scale + scale/2;
+        corners[corner].init(left && !coarse.col ? 0 : col, top && !coarse.row ? 0 : row,
+                             coarse.col_confidence, coarse.row_confidence);
+        if (!coarse.col_confidence && !coarse.row_confidence) continue;
+
+        CornerCandidate fine = refine_corner(input_image, corner, col, row, radius, pre_processing, params);
+        if (fine.col_confidence || fine.row_confidence) corners[corner] = fine;
+    }
+    return merge_corners(corners);
+}
+
 /*
  Questa funzione contiene il codice che ricerca le linee bianche che hanno inizio in un pixel candidato per essere un angolo 
- dell'immagine. Il sistema è implementato come una macchina a stati.
+ dell'immagine. Il sistema è descritto come una macchina a stati.
+ Nello stato KEEP_CHASING viene cercata una linea di pixel bianchi esattamente orizzontale o esattamente verticale,
+ in base alla direzione. Quando viene trovato un pixel nero, se l'inseguimento si è interrotto dopo almeno
+ CHASE_DEPTH / 2 avanzamenti che hanno avuto successo, l'automa entra nello stato ADJUST_ORIENTATION, altrimenti il
+ pixel di partenza non può essere un angolo.
+ In ADJUST_ORIENTATION l'automa cambia l'orientazione della retta da inseguire ed entra nello stato FIT_LINE,
+ ripartendo dal pixel di partenza. La prima volta l'orientazione scelta forma un angolo di -15° rispetto alla retta
+ dritta; se l'inseguimento fallisce l'automa prova con -10°, quindi -5°, 5°, 10° e 15°. Se anche l'ultimo tentativo
+ fallisce il pixel di partenza non può essere un angolo.
+ L'automa è specializzato in fase di compilazione sulla direzione dell'inseguimento, dunque gli stati diventano
+ semplici cicli: gli spostamenti sono costanti note al compilatore, e le rette inclinate sono percorse con aritmetica
+ intera alla Bresenham invece che con una moltiplicazione in virgola mobile per pixel.
+ ChaseDirection descrive una direzione: (ROW_STEP, COL_STEP) è lo spostamento di next_pixel, (SLOPE_ROW, SLOPE_COL)
+ è la direzione in cui una retta con coefficiente angolare positivo si allontana dalla retta dritta.
 */
 
-bool edge_chase(const Mat &image, int row, int col, int chase_direction) {
-    // next_pixel è la funzione utilizzata per muoversi all'interno dell'immagine secondo la direzione dettata dal 
-    // parametro chase_direction. Possibili direzioni sono Nord -> Sud, Sud -> Nord, Ovest -> Est, Est -> Ovest .
-    void (*next_pixel) (int &row, int &col);
-    // line_fit è la funzione che determina le coordinate dei pixel che giacciono su una retta descritta dai parametri 
-    // M, il coefficiente angolare, start_row e start_col, ovvero il punto da cui ha inizio la retta. 
-    // Anche in questo caso l'implementazione dipende dalla direzione dettata da chase_direction.
-    void (*line_fit) (double M, int start_row, int start_col, int curr_row, int curr_col, int &projected_row, int &projected_col);
+template <int DIRECTION> struct ChaseDirection;
+template <> struct ChaseDirection<W_E> { enum { ROW_STEP = 0, COL_STEP = 1, SLOPE_ROW = 1, SLOPE_COL = 0 }; };
+template <> struct ChaseDirection<E_W> { enum { ROW_STEP = 0, COL_STEP = -1, SLOPE_ROW = -1, SLOPE_COL = 0 }; };
+template <> struct ChaseDirection<N_S> { enum { ROW_STEP = 1, COL_STEP = 0, SLOPE_ROW = 0, SLOPE_COL = 1 }; };
+template <> struct ChaseDirection<S_N> { enum { ROW_STEP = -1, COL_STEP = 0, SLOPE_ROW = 0, SLOPE_COL = -1 }; };
+
+template <int DIRECTION, class EdgeImage>
+static bool chase_edge_along(const EdgeImage &image, int start_row, int start_col, const PageFrame &params,
+                             const RunLengthIndex *index, long &visited) {
+    typedef ChaseDirection<DIRECTION> D;
+
+    // Se il pixel di partenza è nero, non può essere un cadidato come angolo, dunque la funzione ritorna falso.
+    // visited conta le letture dell'immagine (o dell'indice) effettuate dall'inseguimento.
+    ++visited;
+    if (!edge_pixel(image, start_row, start_col)) return false;
+
+    // KEEP_CHASING: inseguimento della retta perfettamente orizzontale o verticale. Come nella macchina a stati, il
+    // primo pixel esaminato dista due passi da quello di partenza. I pixel oltre il bordo dell'immagine, in qualsiasi
+    // direzione, interrompono l'inseguimento.
+    int row = start_row + 2*D::ROW_STEP, col = start_col + 2*D::COL_STEP;
+    if (has_straight_runs(image, index)) {
+        // Con l'indice, dopo run pixel bianchi iterations vale 1 + run. Le sequenze più lunghe di CHASE_DEPTH - 1
+        // pixel hanno lo stesso esito, dunque la lunghezza può essere limitata a CHASE_DEPTH - 1.
+        if (!edge_contains(image, row, col)) return false;
+        ++visited;
+        int run = straight_run(image, index, row, col, DIRECTION, params.CHASE_DEPTH - 1);
+        if (1 + run >= params.CHASE_DEPTH) return true;
+        // La sequenza termina sul bordo dell'immagine: l'inseguimento pixel per pixel uscirebbe dall'immagine prima
+        // di trovare un pixel nero.
+        if (!edge_contains(image, row + run*D::ROW_STEP, col + run*D::COL_STEP)) return false;
+        if (1 + run < params.CHASE_DEPTH / 2) return false;
+    }
+    else {
+        int iterations = 1;
+        for (;; row += D::ROW_STEP, col += D::COL_STEP) {
+            if (!edge_contains(image, row, col)) return false;
+            ++visited;
+            if (!edge_pixel(image, row, col)) break;
+            if (++iterations == params.CHASE_DEPTH) return true;
+        }
+        if (iterations < params.CHASE_DEPTH / 2) return false;
+    }
+
+    // ADJUST_ORIENTATION e FIT_LINE: le rette inclinate di TANGENT_TABLE_MILLI[i] / 1000. Dopo dx passi la retta si è
+    // allontanata di dy = dx x |M| / 1000 pixel (troncato, come la conversione ad int di line_fit): error è il resto
+    // della divisione, e poiché |M| < 1000 dy aumenta al più di uno per passo.
+    int adjustments = std::min(params.MAX_ADJUSTMENTS, TANGENT_TABLE_SIZE);
+    for (int adjustment=0; adjustment<adjustments; ++adjustment) {
+        int slope = PageFrame::TANGENT_TABLE_MILLI[adjustment];
+        int rise = slope < 0 ? -slope : slope;
+        int cross_row = slope < 0 ? -D::SLOPE_ROW : D::SLOPE_ROW;
+        int cross_col = slope < 0 ? -D::SLOPE_COL : D::SLOPE_COL;
+        int dy = 0, error = 0;
+        row = start_row;
+        col = start_col;
+        for (int iterations=1;;) {
+            row += D::ROW_STEP;
+            col += D::COL_STEP;
+            error += rise;
+            if (error >= 1000) {
+                error -= 1000;
+                ++dy;
+            }
+            int projected_row = row + dy*cross_row, projected_col = col + dy*cross_col;
+            if (!edge_contains(image, projected_row, projected_col)) break;
+            ++visited;
+            if (!edge_pixel(image, projected_row, projected_col)) break;
+            if (++iterations == params.CHASE_DEPTH) return true;
+        }
+    }
+    return false;
+}
 
-    // L'implementazione di next_pixel e line_fit viene determinata in base a chase_direction
+template <class EdgeImage>
+static bool chase_edge(const EdgeImage &image, int row, int col, int chase_direction, const PageFrame &params,
+                       const RunLengthIndex *index, long &visited) {
     switch (chase_direction) {
-        case W_E:
-            next_pixel = next_pixel_W_E;
-            line_fit = line_fit_W_E;
-            break;
-        case E_W:
-            next_pixel = next_pixel_E_W;
-            line_fit = line_fit_E_W;
-            break;
-        case N_S:
-            next_pixel = next_pixel_N_S;
-            line_fit = line_fit_N_S;
-            break;
-        case S_N:
-            next_pixel = next_pixel_S_N;
-            line_fit = line_fit_S_N;
-            break;
+        case W_E: return chase_edge_along<W_E>(image, row, col, params, index, visited);
+        case E_W: return chase_edge_along<E_W>(image, row, col, params, index, visited);
+        case N_S: return chase_edge_along<N_S>(image, row, col, params, index, visited);
+        case S_N: return chase_edge_along<S_N>(image, row, col, params, index, visited);
         default:
             std::cerr<<"edge_chasing.edge_chase(): Possible directions are West -> East, East -> West, North -> South, South -> North\n";
             exit(1);
     }
+}
 
-    // Se il pixel di partenza è nero, non può essere un cadidato come angolo, dunque la funzione ritorna falso.
-    unsigned char gray_value;
-    gray_value = image.at<unsigned char>(row, col);
-    if (!gray_value) return false;
-
-    int start_row = row;
-    int start_col = col;
-    int projected_row, projected_col;
-    next_pixel(row, col);
-
-    // Vengono inizializzate le variabili di stato
-    int iterations = 1;
-    int adjustments = 0;
-    double M;
-    int current_state;
-    int next_state = KEEP_CHASING;
-
-    // La macchina a stati
-    for (;;) {
-        current_state = next_state;
-
-        // L'automa a stati inizia nello stato KEEP_CHASING, in cui ricerca una linea di pixel bianchi esattamente 
-        // orizzontale o esattamente verticale, in base all'implementazione scelta di next_pixel. 
-        // Quando viene trovato un pixel nero e se l'inseguimento si è interrotto dopo una sequenza di lunghezza
-        // predefinita di avanzamenti che hanno avuto successo, l'automa non conclude immediatamente che il pixel
-        // di partenza non può essere un angolo, ma effettua una transizione verso lo stato ADJUST_ORIENTATION.
-        // Se l'inseguimento invece si interrompe dopo una breve sequenza di pixel bianchi, il pixel di partenza non 
-        // può essere un angolo.
-        // Fintanto che si trova nello stato KEEP_CHASING, l'automa cerca di inseguire rette perfettamente orizzontali
-        // o perfettamente verticali. Quando entra in ADJUST_ORIENTATION cerca di cambiare l'orientazione della retta da
-        // inseguire ed entra nello stato FIT_LINE.
-        // La prima volta l'orientazione scelta forma un angolo di -15° rispetto all'orizzontale, se l'inseguimento lungo
-        // tale retta fallisce, l'automa prova con un'orientazione pari a -10°, se fallisce di nuovo ritenta con
-        // orientazione pari a -5°, quindi 5°, 10°, e 15°. Se di nuovo fallisce l'automa decreta finalmente che
-        // il pixel di partenza non può essere un angolo.
-        switch (current_state) {
-            case KEEP_CHASING:
-                next_pixel(row, col);
-                if (!valid_pixel(image, row, col)) return false;
-                gray_value = image.at<unsigned char>(row, col);
-                
-                // Calcolo dello stato futuro
-                if (gray_value) {
-                    iterations++;
-                    if (iterations == PageFrame::CHASE_DEPTH) return true;
-                    else next_state = KEEP_CHASING;
-                }
-                else if (iterations >= PageFrame::CHASE_DEPTH / 2)  next_state = ADJUST_ORIENTATION;
-                else return false;
-
-                break;
-            case ADJUST_ORIENTATION:
-                // Dopo 6 tentativi di aggiustamento dell'angolo, l'automa si arrende.
-                if (adjustments == PageFrame::MAX_ADJUSTMENTS) return false;
-
-                // Reset delle variabili di stato
-                M = PageFrame::TANGENT_TABLE[adjustments++];
-                row = start_row;
-                col = start_col;
-                iterations = 1;
-
-                // Stato futuro
-                next_state = FIT_LINE;
-
-                break;
-            case FIT_LINE:
-                next_pixel(row, col);
-                line_fit(M, start_row, start_col, row, col, projected_row, projected_col);
-                gray_value = image.at<unsigned char>(projected_row, projected_col);
-
-                // Calcolo dello stato futuro
-                if (gray_value) {
-                    iterations++;
-                    if (iterations == PageFrame::CHASE_DEPTH) return true;
-                    else next_state = FIT_LINE;
-                }
-                else next_state = ADJUST_ORIENTATION;
+bool edge_chase(const Mat &image, int row, int col, int chase_direction, const PageFrame &params,
+                const RunLengthIndex *index) {
+    long visited = 0;
+    return chase_edge(image, row, col, chase_direction, params, index, visited);
+}
 
-                break;
-            default:
-                std::cerr<<"edge_chasing.edge_chase(): invalid state code "<<current_state<<"\n";
-                exit(1);
-        }
-    }
+bool edge_chase(const PackedEdgeMap &image, int row, int col, int chase_direction, const PageFrame &params) {
+    long visited = 0;
+    return chase_edge(image, row, col, chase_direction, params, nullptr, visited);
+}
+
+bool edge_chase(const LazyEdgeMap &image, int row, int col, int chase_direction, const PageFrame &params) {
+    long visited = 0;
+    return chase_edge(image, row, col, chase_direction, params, nullptr, visited);
 }
 
 void next_pixel_W_E(int &row, int &col) {
@@ -375,7 +633,7 @@ void line_fit_S_N(double M, int start_row, int start_col, int curr_row, int curr
 }
 
 bool valid_pixel(const Mat &image, int row, int col) {
-    return row < image.size[0] && col < image.size[1];
+    return row >= 0 && col >= 0 && row < image.size[0] && col < image.size[1];
 }
 
 /*
@@ -383,147 +641,201 @@ La seguente funzione è una versione rudimentale di get_page_frame.
 In particolare l'inseguimento delle linee di pixel bianchi consiste semplicemente nella ricerca di linee 
 perfettamente dritte (orizzontali o verticali) e senza alcuna interruzione.
 Anche la scelta degli angoli tra i candidati ottenuti è semplificata.
+Ogni ricerca fissa una riga (o una colonna) esterna e cerca, lungo di essa, il primo pixel da cui parte una sequenza
+di RUDIMENTARY_DEPTH pixel bianchi perpendicolare, nella direzione in cui avanza la ricerca. Le linee esterne sono
+quindi lette una sola volta, nell'ordine della ricerca, mantenendo per ogni posizione lungo la linea il numero di
+pixel bianchi consecutivi che terminano sulla linea corrente: quando il contatore raggiunge RUDIMENTARY_DEPTH, dalla
+linea che si trova RUDIMENTARY_DEPTH - 1 linee indietro parte una sequenza completa. La memoria necessaria è una
+linea di contatori, ed il costo della ricerca è lineare nel numero di pixel letti e non dipende da RUDIMENTARY_DEPTH.
+I pixel fuori dall'immagine sono considerati neri.
 */
 
-Rect rudimentary_get_page_frame(const Mat &filtered_image) {
-    int margin_search_x_bound = filtered_image.size[1] / 2;
-    int margin_search_y_bound = filtered_image.size[0] / 2;
+// Restituisce vero se trova il primo pixel da cui parte una sequenza di depth pixel bianchi nella direzione di
+// outer_step, e ne scrive in stop la riga e la colonna. Se by_rows è vero la linea esterna è una riga e la ricerca si
+// sposta lungo le colonne, altrimenti il contrario. Gli estremi outer_end e inner_end sono esclusi.
+static bool margin_search(const Mat &image, bool by_rows, int outer_from, int outer_end, int outer_step,
+                          int inner_from, int inner_end, int inner_step, int depth, int stop[2]) {
+    int lines = by_rows ? image.size[0] : image.size[1];
+    int size = by_rows ? image.size[1] : image.size[0];
+    // Le sole posizioni lungo la linea che appartengono all'intervallo di ricerca ed all'immagine
+    int lowest = std::max(inner_step > 0 ? inner_from : inner_end + 1, 0);
+    int highest = std::min(inner_step > 0 ? inner_end - 1 : inner_from, size - 1);
+    if (lowest > highest || depth < 1) return false;
+    std::vector<int> white_run(size, 0);
+
+    for (int line=outer_from; ; line += outer_step) {
+        // La linea esterna da cui parte una sequenza di depth pixel bianchi che termina sulla linea corrente
+        int start = line - outer_step * (depth - 1);
+        if (outer_step > 0 ? start >= outer_end : start <= outer_end) return false;
+        bool complete = false;
+        if (line < 0 || line >= lines) {
+            std::fill(white_run.begin(), white_run.end(), 0);
+            continue;
+        }
+        for (int p=lowest; p<=highest; ++p) {
+            bool white = by_rows ? image.at<unsigned char>(line, p) : image.at<unsigned char>(p, line);
+            white_run[p] = white ? white_run[p] + 1 : 0;
+            complete |= white_run[p] >= depth;
+        }
+        if (!complete || (start - outer_from) * outer_step < 0) continue;
+        for (int inner=inner_from; inner_step > 0 ? inner < inner_end : inner > inner_end; inner += inner_step) {
+            if (inner >= lowest && inner <= highest && white_run[inner] >= depth) {
+                stop[0] = by_rows ? start : inner;
+                stop[1] = by_rows ? inner : start;
+                return true;
+            }
+        }
+    }
+}
+
+Rect rudimentary_get_page_frame(const Mat &filtered_image, const PageFrame &params) {
+    int rows = filtered_image.size[0], cols = filtered_image.size[1];
+    int margin_search_x_bound = cols / 2;
+    int margin_search_y_bound = rows / 2;
+    int depth = params.RUDIMENTARY_DEPTH;
     int TL_corner[2], TR_corner[2], BL_corner[2], BR_corner[2];
-    unsigned char boundary;
 
     // Top Left corner search
     int X_stop[2] = {0, 0};
-    bool found_margin = false;
-    for (int row=0; row<margin_search_y_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++row) {
-        for (int col=0; col<margin_search_x_bound && !found_margin; ++col) {
-            boundary = 255;
-            for (int k=row; k<row+PageFrame::RUDIMENTARY_DEPTH && boundary; ++k) {
-                boundary &= filtered_image.at<unsigned char>(k, col);
-            }
-            if (boundary) {
-                X_stop[0] = row;
-                X_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
-    found_margin = false;
+    margin_search(filtered_image, true, 0, margin_search_y_bound + depth, 1,
+                  0, margin_search_x_bound, 1, depth, X_stop);
     int Y_stop[2] = {0, 0};
-    for (int col=0; col<margin_search_x_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++col) {
-        for (int row=0; row<margin_search_y_bound && !found_margin; ++row) {
-            boundary = 255;
-            for (int k=col; k<col+PageFrame::RUDIMENTARY_DEPTH && boundary; ++k) {
-                boundary &= filtered_image.at<unsigned char>(row, k);
-            }
-            if (boundary) {
-                Y_stop[0] = row;
-                Y_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
+    margin_search(filtered_image, false, 0, margin_search_x_bound + depth, 1,
+                  0, margin_search_y_bound, 1, depth, Y_stop);
     TL_corner[0] = min(X_stop[0], Y_stop[0]);
     TL_corner[1] = min(X_stop[1], Y_stop[1]);
 
     // Top right corner search
-    X_stop[0] = 0; X_stop[1] = filtered_image.size[1] - 1;
-    Y_stop[0] = 0; Y_stop[1] = filtered_image.size[1] - 1;
-    found_margin = false;
-    for (int row=0; row<margin_search_y_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++row) {
-        for (int col=filtered_image.size[1]-1; col>=filtered_image.size[1] - margin_search_x_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --col) {
-            boundary = 255;
-            for (int k=row; k<row+PageFrame::RUDIMENTARY_DEPTH && boundary; ++k) {
-                boundary &= filtered_image.at<unsigned char>(k, col);
-            }
-            if (boundary) {
-                X_stop[0] = row;
-                X_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
-    found_margin = false;
-    for (int col= filtered_image.size[1]-1; col>=filtered_image.size[1] - margin_search_x_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --col) {
-        for (int row=0; row<margin_search_y_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++row) {
-            boundary = 255;
-            for (int k=col; k>col-PageFrame::RUDIMENTARY_DEPTH && boundary; --k) {
-                boundary &= filtered_image.at<unsigned char>(row, k);
-            }
-            if (boundary) {
-                Y_stop[0] = row;
-                Y_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
+    X_stop[0] = 0; X_stop[1] = cols - 1;
+    Y_stop[0] = 0; Y_stop[1] = cols - 1;
+    margin_search(filtered_image, true, 0, margin_search_y_bound + depth, 1,
+                  cols - 1, cols - margin_search_x_bound - depth - 1, -1, depth, X_stop);
+    margin_search(filtered_image, false, cols - 1, cols - margin_search_x_bound - depth - 1, -1,
+                  0, margin_search_y_bound + depth, 1, depth, Y_stop);
     TR_corner[0] = min(X_stop[0], Y_stop[0]);
     TR_corner[1] = max(X_stop[1], Y_stop[1]);
 
     // Bottom left corner search
-    X_stop[0] = filtered_image.size[0] - 1; X_stop[1] = 0;
-    Y_stop[0] = filtered_image.size[0] - 1; Y_stop[1] = 0;
-    found_margin = false;
-    for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0] - margin_search_y_bound && !found_margin; --row) {
-        for (int col=0; col<margin_search_x_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++col) {
-            boundary = 255;
-            for (int k=row; k>row-PageFrame::RUDIMENTARY_DEPTH && boundary; --k) {
-                boundary &= filtered_image.at<unsigned char>(k, col);
-            }
-            if (boundary) {
-                X_stop[0] = row;
-                X_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
-    found_margin = false;
-    for (int col=0; col<margin_search_x_bound+PageFrame::RUDIMENTARY_DEPTH && !found_margin; ++col) {
-        for (int row=filtered_image.size[0]-1; row>=filtered_image.size[0] - margin_search_y_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --row) {
-            boundary = 255;
-            for (int k=col; k<col + PageFrame::RUDIMENTARY_DEPTH && boundary; ++k) {
-                boundary &= filtered_image.at<unsigned char>(row, k);
-            }
-            if (boundary) {
-                Y_stop[0] = row;
-                Y_stop[1] = col;
-                found_margin = true;
-            }
-        }
-    }
+    X_stop[0] = rows - 1; X_stop[1] = 0;
+    Y_stop[0] = rows - 1; Y_stop[1] = 0;
+    margin_search(filtered_image, true, rows - 1, rows - margin_search_y_bound - 1, -1,
+                  0, margin_search_x_bound + depth, 1, depth, X_stop);
+    margin_search(filtered_image, false, 0, margin_search_x_bound + depth, 1,
+                  rows - 1, rows - margin_search_y_bound - depth - 1, -1, depth, Y_stop);
     BL_corner[0] = max(X_stop[0], Y_stop[0]);
     BL_corner[1] = min(X_stop[1], Y_stop[1]);
 
-    // Bottom right corner search
-    X_stop[0] = filtered_image.size[0] - 1; X_stop[1] = filtered_image.size[1] - 1;
-    Y_stop[0] = filtered_image.size[0] - 1; Y_stop[1] = filtered_image.size[1] - 1;
-    found_margin = false;
-    for (int row=filtered_image.size[0] - 1; row>=filtered_image.size[0] - margin_search_y_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --row) {
-        for (int col=filtered_image.size[1] - 1; col>=filtered_image.size[1] - margin_search_x_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --col) {
-            boundary = 255;
-            for (int k=row; k>row - PageFrame::RUDIMENTARY_DEPTH && boundary; --k) {
-                boundary &= filtered_image.at<unsigned char>(k, col);
-            }
-            if (boundary) {
-                X_stop[0] = row;
-                X_stop[1] = col;
-                found_margin = true;
+    // Bottom right corner search. La ricerca per colonne si arresta alla riga cols - margin_search_y_bound - depth.
+    X_stop[0] = rows - 1; X_stop[1] = cols - 1;
+    Y_stop[0] = rows - 1; Y_stop[1] = cols - 1;
+    margin_search(filtered_image, true, rows - 1, rows - margin_search_y_bound - depth - 1, -1,
+                  cols - 1, cols - margin_search_x_bound - depth - 1, -1, depth, X_stop);
+    margin_search(filtered_image, false, cols - 1, cols - margin_search_x_bound - depth - 1, -1,
+                  rows - 1, cols - margin_search_y_bound - depth - 1, -1, depth, Y_stop);
+    BR_corner[0] = max(X_stop[0], Y_stop[0]);
+    BR_corner[1] = max(X_stop[1], X_stop[1]);
+
+    // The rectangle that represents the page frame
+    int y_offset = min(TL_corner[0], TR_corner[0]);
+    int x_offset = min(TL_corner[1], BL_corner[1]);
+
+    int height = max(BL_corner[0], BR_corner[0]) - y_offset - 1;
+    int width = max(TR_corner[1], BR_corner[1]) - x_offset - 1;
+    return {x_offset, y_offset, width, height};
+}
+
+/*
+ La versione rudimentale sull'immagine compressa ad un bit per pixel. Ciascuna delle 8 ricerche della versione ad 8
+ bit fissa una riga (o una colonna) esterna e cerca, lungo di essa, il primo pixel da cui parte una sequenza di
+ RUDIMENTARY_DEPTH pixel bianchi perpendicolare. Con le linee compresse, la sequenza perpendicolare diventa l'AND
+ delle RUDIMENTARY_DEPTH linee consecutive, calcolato 64 pixel alla volta, ed il primo pixel cercato è il primo bit
+ non nullo del risultato.
+ margin_search restituisce vero se trova il pixel, e ne scrive in stop la riga e la colonna. Se by_rows è vero la
+ linea esterna è una riga e la ricerca si sposta lungo le colonne, altrimenti il contrario. Gli estremi outer_end e
+ inner_end sono esclusi.
+*/
+
+static bool margin_search(const PackedEdgeMap &image, bool by_rows, int outer_from, int outer_end, int outer_step,
+                          int depth_step, int inner_from, int inner_end, int inner_step, int depth, int stop[2]) {
+    int lines = by_rows ? image.rows() : image.cols();
+    int size = by_rows ? image.cols() : image.rows();
+    if (size <= 0) return false;
+    // Le sole parole che contengono l'intervallo di ricerca lungo la linea
+    int lowest = std::max(std::min(inner_from, inner_end + 1), 0), highest = std::min(std::max(inner_from, inner_end - 1), size - 1);
+    if (lowest > highest) return false;
+    int first_word = lowest >> 6, last_word = highest >> 6;
+    std::vector<uint64_t> boundary((size + 63) / 64, 0);
+
+    for (int outer=outer_from; outer_step > 0 ? outer < outer_end : outer > outer_end; outer += outer_step) {
+        int last_line = outer + depth_step * (depth - 1);
+        // Le linee fuori dall'immagine sono nere, dunque l'AND è nullo.
+        if (outer < 0 || outer >= lines || last_line < 0 || last_line >= lines) continue;
+        bool any = false;
+        for (int word=first_word; word<=last_word; ++word) boundary[word] = ~(uint64_t) 0;
+        for (int k=0; k<depth; ++k) {
+            int line = outer + depth_step * k;
+            const uint64_t* bits = by_rows ? image.row_line(line) : image.column_line(line);
+            any = false;
+            for (int word=first_word; word<=last_word; ++word) {
+                boundary[word] &= bits[word];
+                any |= boundary[word] != 0;
             }
+            if (!any) break;
         }
-    }
-    found_margin = false;
-    for(int col=filtered_image.size[1] - 1; col >= filtered_image.size[1] - margin_search_x_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --col) {
-        for (int row=filtered_image.size[0] - 1; row >= filtered_image.size[1] - margin_search_y_bound - PageFrame::RUDIMENTARY_DEPTH && !found_margin; --row) {
-            boundary = 255;
-            for (int k=col; k>col - PageFrame::RUDIMENTARY_DEPTH && boundary; --k) {
-                boundary &= filtered_image.at<unsigned char>(row, k);
-            }
-            if (boundary) {
-                Y_stop[0] = row;
-                Y_stop[1] = col;
-                found_margin = true;
-            }
+        if (!any) continue;
+        int found = PackedEdgeMap::next_set_bit(boundary.data(), size, inner_from, inner_end, inner_step);
+        if (found >= 0) {
+            stop[0] = by_rows ? outer : found;
+            stop[1] = by_rows ? found : outer;
+            return true;
         }
     }
+    return false;
+}
+
+Rect rudimentary_get_page_frame(const PackedEdgeMap &filtered_image, const PageFrame &params) {
+    int rows = filtered_image.rows(), cols = filtered_image.cols();
+    int margin_search_x_bound = cols / 2;
+    int margin_search_y_bound = rows / 2;
+    int depth = params.RUDIMENTARY_DEPTH;
+    int TL_corner[2], TR_corner[2], BL_corner[2], BR_corner[2];
+
+    // Top Left corner search
+    int X_stop[2] = {0, 0};
+    margin_search(filtered_image, true, 0, margin_search_y_bound + depth, 1, 1, 0, margin_search_x_bound, 1, depth, X_stop);
+    int Y_stop[2] = {0, 0};
+    margin_search(filtered_image, false, 0, margin_search_x_bound + depth, 1, 1, 0, margin_search_y_bound, 1, depth, Y_stop);
+    TL_corner[0] = min(X_stop[0], Y_stop[0]);
+    TL_corner[1] = min(X_stop[1], Y_stop[1]);
+
+    // Top right corner search
+    X_stop[0] = 0; X_stop[1] = cols - 1;
+    Y_stop[0] = 0; Y_stop[1] = cols - 1;
+    margin_search(filtered_image, true, 0, margin_search_y_bound + depth, 1, 1,
+                  cols - 1, cols - margin_search_x_bound - depth - 1, -1, depth, X_stop);
+    margin_search(filtered_image, false, cols - 1, cols - margin_search_x_bound - depth - 1, -1, -1,
+                  0, margin_search_y_bound + depth, 1, depth, Y_stop);
+    TR_corner[0] = min(X_stop[0], Y_stop[0]);
+    TR_corner[1] = max(X_stop[1], Y_stop[1]);
+
+    // Bottom left corner search
+    X_stop[0] = rows - 1; X_stop[1] = 0;
+    Y_stop[0] = rows - 1; Y_stop[1] = 0;
+    margin_search(filtered_image, true, rows - 1, rows - margin_search_y_bound - 1, -1, -1,
+                  0, margin_search_x_bound + depth, 1, depth, X_stop);
+    margin_search(filtered_image, false, 0, margin_search_x_bound + depth, 1, 1,
+                  rows - 1, rows - margin_search_y_bound - depth - 1, -1, depth, Y_stop);
+    BL_corner[0] = max(X_stop[0], Y_stop[0]);
+    BL_corner[1] = min(X_stop[1], Y_stop[1]);
+
+    // Bottom right corner search. Come nella versione ad 8 bit, la ricerca per colonne si arresta alla riga
+    // cols - margin_search_y_bound - depth.
+    X_stop[0] = rows - 1; X_stop[1] = cols - 1;
+    Y_stop[0] = rows - 1; Y_stop[1] = cols - 1;
+    margin_search(filtered_image, true, rows - 1, rows - margin_search_y_bound - depth - 1, -1, -1,
+                  cols - 1, cols - margin_search_x_bound - depth - 1, -1, depth, X_stop);
+    margin_search(filtered_image, false, cols - 1, cols - margin_search_x_bound - depth - 1, -1, -1,
+                  rows - 1, cols - margin_search_y_bound - depth - 1, -1, depth, Y_stop);
     BR_corner[0] = max(X_stop[0], Y_stop[0]);
     BR_corner[1] = max(X_stop[1], X_stop[1]);
 
@@ -1,9 +1,10 @@
 #ifndef SERVER_APP_EDGE_CHASING_H
 #define SERVER_APP_EDGE_CHASING_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
+#include "corners.h"
+#include "pre_processing.h"
+#include <atomic>
 #define W_E 0
 #define E_W 1
 #define N_S 2
@@ -11,29 +12,101 @@
 #define KEEP_CHASING 0
 #define ADJUST_ORIENTATION 2
 #define FIT_LINE 3
+#define TL_CORNER 0
+#define TR_CORNER 1
+#define BL_CORNER 2
+#define BR_CORNER 3
+#define TANGENT_TABLE_SIZE 6
 using namespace cv;
 
+class RunLengthIndex;
+class PackedEdgeMap;
+class LazyEdgeMap;
+
+// Contatori della ricerca degli angoli: chiamate di edge_chase e pixel letti dagli inseguimenti.
+class EdgeChaseCounters {
+public:
+    std::atomic<long> calls{0};
+    std::atomic<long> pixels{0};
+};
+
 /*
  Questo modulo contiene il codice responsabile di rimuovere lo sfondo dall'immagine, mantenendo solo il rettangolo che
  contiene il foglio da scannerizzare. Lo sfondo solitamente corrisponde al tavolo su cui è appoggiato il foglio.
  La classe PageFrame contiene esclusivamente dei parametri, che possono essere inizializzati tramite un apposito
- costruttore.
+ costruttore. TANGENT_TABLE è una costante dell'algoritmo ed è condivisa da tutte le istanze.
+ Se PYRAMID_LEVEL è maggiore di zero, la pagina viene cercata prima su una versione dell'immagine ridotta di un fattore
+ 2^PYRAMID_LEVEL, e gli angoli trovati vengono poi rifiniti a piena risoluzione (vedi coarse_to_fine_page_frame).
 */
 
 class PageFrame {
 public:
 
-    static int CHASE_DEPTH;
-    static int MAX_ADJUSTMENTS;
-    static int RUDIMENTARY_DEPTH;
-    static double TANGENT_TABLE[];
+    int CHASE_DEPTH = 400;
+    int MAX_ADJUSTMENTS = 6;
+    int RUDIMENTARY_DEPTH = 200;
+    int PYRAMID_LEVEL = 0;
+    // Se vero, la ricerca sull'immagine filtrata ad 8 bit costruisce un RunLengthIndex e lo utilizza in edge_chase.
+    // L'indice occupa 8 byte per pixel (circa 96 MB a 12 megapixel) e la sua costruzione, ad ogni chiamata, costa
+    // più delle chiamate di edge_chase che accelera su un'immagine tipica: conviene solo se le chiamate sono molte.
+    bool RUN_LENGTH_INDEX = false;
+    // Se vero, la pipeline comprime l'immagine filtrata in un PackedEdgeMap prima di cercare gli angoli
+    bool PACKED_EDGE_MAP = true;
+    // Se vero, la pipeline non pre-processa l'intera immagine, ma cerca gli angoli in un LazyEdgeMap, che calcola
+    // l'immagine filtrata solo nei tasselli letti dalla ricerca. Ha la precedenza su PACKED_EDGE_MAP.
+    bool LAZY_EDGE_MAP = false;
+    // Se non è nullo, la ricerca degli angoli vi accumula il numero di chiamate di edge_chase e di pixel letti
+    EdgeChaseCounters* CHASE_COUNTERS = nullptr;
+    static const double TANGENT_TABLE[];
+    // TANGENT_TABLE in millesimi, utilizzata da edge_chase per percorrere le rette inclinate con aritmetica intera
+    static const int TANGENT_TABLE_MILLI[];
 
+    PageFrame() = default;
     explicit PageFrame(int chase_depth, int max_adjustments, int rudimentary_depth);
 };
 
-Rect get_page_frame(const Mat &filtered_image);
-Rect rudimentary_get_page_frame(const Mat &filtered_image);
-bool edge_chase(const Mat &image, int row, int col, int chase_direction);
+Rect get_page_frame(const Mat &filtered_image, const PageFrame &params = PageFrame());
+Rect rudimentary_get_page_frame(const Mat &filtered_image, const PageFrame &params = PageFrame());
+// Le stesse ricerche sull'immagine filtrata compressa ad un bit per pixel (vedi packed_edge_map.h). I pixel fuori
+// dall'immagine sono considerati neri.
+Rect get_page_frame(const PackedEdgeMap &filtered_image, const PageFrame &params = PageFrame());
+Rect rudimentary_get_page_frame(const PackedEdgeMap &filtered_image, const PageFrame &params = PageFrame());
+// La ricerca sull'immagine filtrata calcolata a tasselli, solo dove viene letta (vedi lazy_edge_map.h).
+Rect get_page_frame(const LazyEdgeMap &filtered_image, const PageFrame &params = PageFrame());
+// Ricerca multi-risoluzione: pre-processing e ricerca degli angoli sono eseguiti sul livello PYRAMID_LEVEL della
+// piramide dell'immagine di input, e ciascun angolo viene rifinito a piena risoluzione in una piccola finestra.
+// Il rettangolo restituito è espresso nelle coordinate di input_image.
+Rect coarse_to_fine_page_frame(const Mat &input_image, const PreProcessing &pre_processing,
+                               const PageFrame &params = PageFrame());
+// Cerca un angolo in una finestra di lato 2 x radius + 1 centrata in (row, col), eseguendo il pre-processing solo su
+// un ritaglio di input_image attorno alla finestra. Utilizzata da coarse_to_fine_page_frame e da FrameTracker.
+CornerCandidate refine_corner(const Mat &input_image, int corner, int col, int row, int radius,
+                              const PreProcessing &pre_processing, const PageFrame &params);
+
+// Le fasi della ricerca degli angoli, utilizzate da get_page_frame. corner è uno tra TL_CORNER, TR_CORNER, BL_CORNER
+// e BR_CORNER. search_area è la regione in cui vengono cercati i pixel di partenza dei contorni.
+Rect corner_search_area(const Mat &filtered_image, int corner);
+Rect corner_search_area(int rows, int cols, int corner);
+CornerCandidate corner_search_pass(const Mat &filtered_image, int corner, bool rows_first, const Rect &search_area,
+                                   const PageFrame &params, const RunLengthIndex *index = nullptr);
+CornerCandidate pick_corner(int corner, const CornerCandidate &X_corner, const CornerCandidate &Y_corner,
+                            const Rect &search_area);
+CornerCandidate find_corner(const Mat &filtered_image, int corner, const Rect &search_area, const PageFrame &params,
+                            const RunLengthIndex *index = nullptr);
+// Cerca i 4 angoli, ciascuno nella rispettiva area, eseguendo le 8 passate della ricerca in parallelo.
+void find_corners(const Mat &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4], const RunLengthIndex *index = nullptr);
+void find_corners(const PackedEdgeMap &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4]);
+void find_corners(const LazyEdgeMap &filtered_image, const Rect search_areas[4], const PageFrame &params,
+                  CornerCandidate corners[4]);
+Rect merge_corners(const CornerCandidate corners[4]);
+// Se index non è nullo deve essere l'indice di image: l'inseguimento delle rette orizzontali e verticali viene
+// risolto tramite l'indice, senza percorrere i pixel.
+bool edge_chase(const Mat &image, int row, int col, int chase_direction, const PageFrame &params = PageFrame(),
+                const RunLengthIndex *index = nullptr);
+bool edge_chase(const PackedEdgeMap &image, int row, int col, int chase_direction, const PageFrame &params = PageFrame());
+bool edge_chase(const LazyEdgeMap &image, int row, int col, int chase_direction, const PageFrame &params = PageFrame());
 bool valid_pixel(const Mat &image, int row, int col);
 
 void next_pixel_W_E(int &row, int &col);
@@ -51,3 +124,5 @@ void skip_ahead_N_S (int &row, int &col, int skip);
 void next_pixel_S_N(int &row, int &col);
 void line_fit_S_N(double M, int start_row, int start_col, int curr_row, int curr_col, int &projected_row, int &projected_col);
 void skip_ahead_S_N (int &row, int &col, int skip);
+
+#endif
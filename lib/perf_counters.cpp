@@ -0,0 +1,117 @@
+#include "perf_counters.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PerfSample &PerfSample::operator+=(const PerfSample &other) {
+    for (int event=0; event<PERF_EVENT_COUNT; ++event) {
+        values[event] += other.values[event];
+        valid[event] = valid[event] || other.valid[event];
+    }
+    wall_ms += other.wall_ms;
+    return *this;
+}
+
+const char* PerfCounters::event_name(int event) {
+    static const char* names[PERF_EVENT_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+    return event >= 0 && event < PERF_EVENT_COUNT ? names[event] : "unknown";
+}
+
+#ifdef __linux__
+
+/*
+ Ogni contatore è aperto separatamente, e non come gruppo, perché i gruppi non possono essere ereditati dai thread
+ figli. La lettura restituisce il valore ed i tempi per cui il contatore è stato abilitato ed effettivamente attivo.
+*/
+
+PerfCounters::PerfCounters() {
+    const uint64_t configs[PERF_EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (int event=0; event<PERF_EVENT_COUNT; ++event) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[event];
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[event] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[event] < 0 && open_error.empty()) {
+            open_error = std::string("perf_event_open(") + event_name(event) + "): " + strerror(errno);
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) if (fd >= 0) close(fd);
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds) if (fd >= 0) return true;
+    return false;
+}
+
+void PerfCounters::start() {
+    for (int fd : fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    start_ms = now_ms();
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    sample.wall_ms = now_ms() - start_ms;
+    for (int event=0; event<PERF_EVENT_COUNT; ++event) {
+        uint64_t data[3];
+        if (fds[event] < 0 || read(fds[event], data, sizeof(data)) != (ssize_t) sizeof(data)) continue;
+        // data[0] è il valore, data[1] il tempo abilitato, data[2] il tempo effettivamente misurato
+        if (data[2] == 0) continue;
+        sample.values[event] = data[2] < data[1] ? (uint64_t) ((double) data[0] * data[1] / data[2]) : data[0];
+        sample.valid[event] = true;
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int &fd : fds) fd = -1;
+    open_error = "hardware counters are only supported on Linux";
+}
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::available() const {
+    return false;
+}
+
+void PerfCounters::start() {
+    start_ms = now_ms();
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    sample.wall_ms = now_ms() - start_ms;
+    return sample;
+}
+
+#endif
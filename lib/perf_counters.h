@@ -0,0 +1,57 @@
+#ifndef SERVER_APP_PERF_COUNTERS_H
+#define SERVER_APP_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define PERF_EVENT_COUNT 4
+
+/*
+ Questo modulo legge i contatori hardware della CPU tramite perf_event_open di Linux: cicli, istruzioni, cache miss
+ e branch miss. I contatori misurano solo lo spazio utente (exclude_kernel), dunque non richiedono privilegi di root
+ con il valore di default di /proc/sys/kernel/perf_event_paranoid (2).
+ I contatori vengono aperti per il thread che costruisce l'oggetto, ed ereditati dai thread che esso crea
+ successivamente: i thread di OpenCV creati prima (per esempio da una parallel_for_ precedente) non sono contati.
+ Per misurare un kernel parallelo per intero conviene quindi costruire PerfCounters prima di qualsiasi elaborazione,
+ oppure eseguire il kernel con un solo thread.
+ Se il kernel multiplexa i contatori, i valori vengono scalati in base al tempo per cui sono stati attivi.
+ Su sistemi diversi da Linux, o se perf_event_open non è permessa, available() restituisce falso.
+*/
+
+class PerfSample {
+public:
+    uint64_t values[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+    double wall_ms = 0;
+
+    PerfSample &operator+=(const PerfSample &other);
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // Vero se almeno uno dei contatori è stato aperto
+    bool available() const;
+    // Motivo per cui i contatori non sono disponibili
+    const std::string &error() const { return open_error; }
+
+    void start();
+    PerfSample stop();
+
+    static const char* event_name(int event);
+
+private:
+    int fds[PERF_EVENT_COUNT];
+    double start_ms = 0;
+    std::string open_error;
+};
+
+#endif
@@ -1,19 +1,94 @@
 #include "pipeline.h"
 #include "binarization.h"
 #include "page_frame.h"
+#include "packed_edge_map.h"
+#include "lazy_edge_map.h"
+#include "pipeline_trace.h"
 #include "pre_processing.h"
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
-Mat execute_processing_pipeline(const Mat &input_image) {
-    // Pre processing
-    Mat pre_processed_image = pre_process_image(input_image);
+Mat execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config) {
+    Workspace workspace;
+    return execute_processing_pipeline(input_image, config, workspace);
+}
+
+Mat execute_processing_pipeline(const FrameBuffer &frame, const ProcessingConfig &config, Workspace &workspace,
+                                PipelineStats* stats) {
+    return execute_processing_pipeline(luma_plane(frame), config, workspace, stats);
+}
+
+/*
+ Le fasi della pipeline, comuni alle due versioni: BinarizedImage è la matrice ad 8 bit oppure il BilevelImage, e
+ determina quale versione di binarize_image viene utilizzata.
+*/
+
+template <class BinarizedImage>
+static void run_pipeline(const Mat &input_image, const ProcessingConfig &config, Workspace &workspace,
+                         PipelineStats* stats, BinarizedImage &binarized_image) {
+    // Se stats non è nullo ogni fase viene misurata, e la ricerca degli angoli conta le chiamate di edge_chase.
+    PipelineTimer pipeline(stats, &workspace);
+    EdgeChaseCounters chase_counters;
+    PageFrame page_frame_params = config.page_frame;
+    if (stats) page_frame_params.CHASE_COUNTERS = &chase_counters;
+
+    // Con GRAYSCALE_FIRST l'immagine a colori viene convertita una sola volta, nella memoria del workspace, e tutte le
+    // fasi successive, compresa la binarizzazione, elaborano l'immagine in grigio.
+    Mat source_image = input_image;
+    if (config.pre_processing.GRAYSCALE_FIRST && input_image.channels() == 3) {
+        StageTimer stage(pipeline, "grayscale");
+        source_image = workspace.matrix(WS_GREY_IMAGE, input_image.size[0], input_image.size[1], CV_8U);
+        cvtColor(input_image, source_image, COLOR_RGB2GRAY);
+    }
 
-    // Estrazione della cornice che contiene la pagina
-    Rect page_frame = get_page_frame(pre_processed_image);
+    // Pre processing ed estrazione della cornice che contiene la pagina. Con PYRAMID_LEVEL maggiore di zero entrambe
+    // le fasi sono eseguite su una versione ridotta dell'immagine, e gli angoli sono poi rifiniti a piena risoluzione.
+    Rect page_frame;
+    if (config.page_frame.PYRAMID_LEVEL > 0) {
+        StageTimer stage(pipeline, "coarse_to_fine");
+        page_frame = coarse_to_fine_page_frame(source_image, config.pre_processing, page_frame_params);
+    }
+    else if (config.page_frame.LAZY_EDGE_MAP) {
+        // Il pre-processing avviene durante la ricerca degli angoli, solo sui tasselli letti.
+        StageTimer stage(pipeline, "corner_search");
+        LazyEdgeMap lazy_image(source_image, config.pre_processing);
+        page_frame = get_page_frame(lazy_image, page_frame_params);
+    }
+    else {
+        // Le due fasi di pre_process_image sono misurate separatamente.
+        Mat pre_processed_image = pre_process_image(source_image, config.pre_processing, pipeline);
+
+        StageTimer stage(pipeline, "corner_search");
+        if (config.page_frame.PACKED_EDGE_MAP) {
+            // L'immagine filtrata ad 8 bit viene rilasciata non appena compressa.
+            PackedEdgeMap packed_image(pre_processed_image);
+            pre_processed_image.release();
+            page_frame = get_page_frame(packed_image, page_frame_params);
+        }
+        else {
+            page_frame = get_page_frame(pre_processed_image, page_frame_params);
+        }
+    }
 
     // Binarizzazione dell'immagine
-    Mat binarized_image = StatisticsBasedBinarization::binarize_image(input_image(page_frame));
+    StageTimer binarization_stage(pipeline, "binarization");
+    config.binarization.binarize_image(source_image(page_frame), binarized_image, workspace);
+    binarization_stage.stop();
+
+    if (stats) {
+        stats->edge_chase_calls = chase_counters.calls;
+        stats->edge_chase_pixels = chase_counters.pixels;
+    }
+}
 
+Mat execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config, Workspace &workspace,
+                                PipelineStats* stats) {
+    Mat binarized_image;
+    run_pipeline(input_image, config, workspace, stats, binarized_image);
     return binarized_image;
 }
+
+void execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config, Workspace &workspace,
+                                 BilevelImage &binarized_image, PipelineStats* stats) {
+    run_pipeline(input_image, config, workspace, stats, binarized_image);
+}
@@ -1,13 +1,42 @@
 #ifndef SERVER_APP_PROCESSING_H
 #define SERVER_APP_PROCESSING_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
+#include "binarization.h"
+#include "bilevel_image.h"
+#include "frame_buffer.h"
+#include "page_frame.h"
+#include "pre_processing.h"
+#include "workspace.h"
+#include "pipeline_trace.h"
 using namespace cv;
 
 /*
-Questo modulo esporta una funzione che mette insieme i vari passaggi della pipeline di elaborazione dell'immagine
+Questo modulo esporta una funzione che mette insieme i vari passaggi della pipeline di elaborazione dell'immagine.
+La classe ProcessingConfig raccoglie i parametri di tutte le fasi. Poiché la configurazione è passata per riferimento
+costante e nessuna fase modifica stato globale, elaborazioni con configurazioni diverse possono essere eseguite
+contemporaneamente.
 */
 
-Mat execute_processing_pipeline(const Mat &input_image);
+class ProcessingConfig {
+public:
+    PreProcessing pre_processing;
+    PageFrame page_frame;
+    StatisticsBasedBinarization binarization;
+};
+
+Mat execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config = ProcessingConfig());
+// Versione che utilizza le matrici temporanee di un workspace mantenuto dal chiamante tra una chiamata e l'altra.
+// Se stats non è nullo vi vengono registrati i tempi e la memoria delle singole fasi (vedi pipeline_trace.h).
+Mat execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config, Workspace &workspace,
+                                PipelineStats* stats = nullptr);
+// Versione che produce l'immagine binarizzata compressa ad un bit per pixel (vedi bilevel_image.h), che può essere
+// salvata con write_bilevel_image senza passare per un'immagine ad 8 bit.
+void execute_processing_pipeline(const Mat &input_image, const ProcessingConfig &config, Workspace &workspace,
+                                 BilevelImage &binarized_image, PipelineStats* stats = nullptr);
+// Versione che elabora il piano Y di un buffer esterno (luminanza o YUV 4:2:0, vedi frame_buffer.h), senza copiarlo
+// e senza conversioni di colore.
+Mat execute_processing_pipeline(const FrameBuffer &frame, const ProcessingConfig &config, Workspace &workspace,
+                                PipelineStats* stats = nullptr);
+
+#endif
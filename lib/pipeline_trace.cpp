@@ -0,0 +1,187 @@
+#include "pipeline_trace.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+using namespace cv;
+
+#if CV_VERSION_MAJOR >= 4
+typedef AccessFlag TraceAccessFlag;
+#else
+typedef int TraceAccessFlag;
+#endif
+
+/*
+ Contatori di memoria del thread corrente: byte allocati dall'installazione dell'allocatore, byte in uso (che
+ possono diventare negativi se il thread libera matrici allocate da altri thread) e massimo dei byte in uso, che
+ StageTimer riporta al valore corrente all'inizio di ogni fase.
+*/
+
+class ThreadAllocations {
+public:
+    long long allocated = 0;
+    long long live = 0;
+    long long peak = 0;
+};
+
+static thread_local ThreadAllocations thread_allocations;
+
+/*
+ L'allocatore delega tutto all'allocatore di default di OpenCV, e si limita ad aggiornare i contatori del thread
+ che alloca o libera una matrice. Le matrici che puntano a memoria esterna non vengono contate.
+*/
+
+class CountingAllocator : public MatAllocator {
+public:
+    explicit CountingAllocator(MatAllocator* base) : base(base) {}
+
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, TraceAccessFlag flags,
+                       UMatUsageFlags usage_flags) const override {
+        UMatData* u = base->allocate(dims, sizes, type, data, step, flags, usage_flags);
+        if (u) {
+            u->currAllocator = this;
+            if (!data) {
+                thread_allocations.allocated += (long long) u->size;
+                thread_allocations.live += (long long) u->size;
+                thread_allocations.peak = std::max(thread_allocations.peak, thread_allocations.live);
+            }
+        }
+        return u;
+    }
+
+    bool allocate(UMatData* u, TraceAccessFlag flags, UMatUsageFlags usage_flags) const override {
+        return base->allocate(u, flags, usage_flags);
+    }
+
+    void deallocate(UMatData* u) const override {
+        if (u && !(u->flags & UMatData::USER_ALLOCATED)) thread_allocations.live -= (long long) u->size;
+        base->deallocate(u);
+    }
+
+private:
+    MatAllocator* base;
+};
+
+/*
+ L'allocatore resta installato finché almeno un PipelineTimer misura, anche su thread diversi. Le matrici allocate
+ durante una misura continuano a puntare al CountingAllocator, che è statico e può liberarle anche dopo la
+ rimozione; la loro liberazione viene ancora contata, ma da quel momento i contatori non vengono più letti.
+*/
+
+static std::mutex allocator_mutex;
+static int active_timers = 0;
+static MatAllocator* previous_allocator = nullptr;
+
+static void acquire_counting_allocator() {
+    std::lock_guard<std::mutex> lock(allocator_mutex);
+    if (active_timers++) return;
+    previous_allocator = Mat::getDefaultAllocator();
+    static CountingAllocator allocator(previous_allocator);
+    Mat::setDefaultAllocator(&allocator);
+}
+
+static void release_counting_allocator() {
+    std::lock_guard<std::mutex> lock(allocator_mutex);
+    if (--active_timers) return;
+    Mat::setDefaultAllocator(previous_allocator);
+}
+
+double trace_clock_ms() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+PipelineTimer::PipelineTimer(PipelineStats* stats, const Workspace* workspace) : stats(stats), workspace(workspace) {
+    if (!stats) return;
+    acquire_counting_allocator();
+    base_live_bytes = thread_allocations.live;
+    base_workspace_bytes = workspace ? workspace->reserved_bytes() : 0;
+    stats->stages.clear();
+    stats->tracked_allocated_bytes = 0;
+    stats->tracked_peak_bytes = 0;
+    stats->start_ms = trace_clock_ms();
+}
+
+PipelineTimer::~PipelineTimer() {
+    if (!stats) return;
+    stats->wall_ms = trace_clock_ms() - stats->start_ms;
+    for (const StageStats &stage : stats->stages) {
+        stats->tracked_allocated_bytes += stage.tracked_allocated_bytes;
+        stats->tracked_peak_bytes = std::max(stats->tracked_peak_bytes, stage.tracked_peak_bytes);
+    }
+    release_counting_allocator();
+}
+
+StageTimer::StageTimer(const PipelineTimer &pipeline, const char* name) : pipeline(pipeline) {
+    if (!pipeline.stats) return;
+    running = true;
+    stage.name = name;
+    thread_allocations.peak = thread_allocations.live;
+    start_allocated = thread_allocations.allocated;
+    start_workspace_bytes = pipeline.workspace ? pipeline.workspace->reserved_bytes() : 0;
+    stage.start_ms = trace_clock_ms();
+}
+
+StageTimer::~StageTimer() {
+    stop();
+}
+
+void StageTimer::stop() {
+    if (!running) return;
+    running = false;
+    stage.wall_ms = trace_clock_ms() - stage.start_ms;
+    size_t workspace_bytes = pipeline.workspace ? pipeline.workspace->reserved_bytes() : 0;
+    stage.tracked_allocated_bytes = (size_t) (thread_allocations.allocated - start_allocated) +
+                            (workspace_bytes - start_workspace_bytes);
+    stage.tracked_peak_bytes = (size_t) std::max(thread_allocations.peak - pipeline.base_live_bytes, 0LL) +
+                       (workspace_bytes - pipeline.base_workspace_bytes);
+    pipeline.stats->stages.push_back(stage);
+}
+
+void PipelineStats::print(FILE* stream) const {
+    fprintf(stream, "%s: %.1f ms, tracked allocated %.1f MB, tracked peak %.1f MB, edge_chase calls %ld, pixels %ld\n",
+            label.empty() ? "pipeline" : label.c_str(), wall_ms, tracked_allocated_bytes / 1048576.0,
+            tracked_peak_bytes / 1048576.0, edge_chase_calls, edge_chase_pixels);
+    for (const StageStats &stage : stages) {
+        fprintf(stream, "  %-16s %9.1f ms  tracked allocated %8.1f MB  tracked peak %8.1f MB\n", stage.name.c_str(),
+                stage.wall_ms, stage.tracked_allocated_bytes / 1048576.0, stage.tracked_peak_bytes / 1048576.0);
+    }
+}
+
+std::string json_string(const std::string &text) {
+    std::string escaped = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if ((unsigned char) c < 0x20) continue;
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+/*
+ Ogni elaborazione diventa un evento completo ("ph": "X") sulla riga del proprio thread, e le sue fasi diventano
+ eventi annidati. I tempi del formato sono in microsecondi.
+*/
+
+void write_chrome_trace(const std::vector<PipelineStats> &batch, FILE* stream) {
+    fprintf(stream, "{\"traceEvents\": [\n");
+    bool first = true;
+    for (const PipelineStats &stats : batch) {
+        fprintf(stream, "%s  {\"name\": %s, \"cat\": \"pipeline\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                        "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"tracked_allocated_bytes\": %zu, "
+                        "\"tracked_peak_bytes\": %zu, \"edge_chase_calls\": %ld, \"edge_chase_pixels\": %ld}}",
+                first ? "" : ",\n", json_string(stats.label.empty() ? "pipeline" : stats.label).c_str(), stats.thread,
+                stats.start_ms * 1000, stats.wall_ms * 1000, stats.tracked_allocated_bytes, stats.tracked_peak_bytes,
+                stats.edge_chase_calls, stats.edge_chase_pixels);
+        first = false;
+        for (const StageStats &stage : stats.stages) {
+            fprintf(stream, ",\n  {\"name\": %s, \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                            "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"tracked_allocated_bytes\": %zu, "
+                            "\"tracked_peak_bytes\": %zu}}",
+                    json_string(stage.name).c_str(), stats.thread, stage.start_ms * 1000, stage.wall_ms * 1000,
+                    stage.tracked_allocated_bytes, stage.tracked_peak_bytes);
+        }
+    }
+    fprintf(stream, "\n], \"displayTimeUnit\": \"ms\"}\n");
+}
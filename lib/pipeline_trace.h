@@ -0,0 +1,99 @@
+#ifndef SERVER_APP_PIPELINE_TRACE_H
+#define SERVER_APP_PIPELINE_TRACE_H
+
+#include "opencv2/opencv.hpp"
+#include "workspace.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+using namespace cv;
+
+/*
+ Questo modulo contiene la strumentazione, opzionale, della pipeline di elaborazione. Se execute_processing_pipeline
+ riceve un PipelineStats, per ogni fase (filtro mediano, edge detection, ricerca degli angoli, binarizzazione)
+ vengono registrati l'istante di inizio, la durata, i byte allocati ed il picco della memoria tracciata; per la
+ ricerca degli angoli vengono registrati anche il numero di chiamate di edge_chase ed il numero di pixel letti.
+ La memoria tracciata non è la memoria del processo: comprende solo le cv::Mat allocate dal thread che esegue la
+ pipeline, contate da un allocatore delle matrici di OpenCV, e la crescita del Workspace. Non sono contate le
+ matrici allocate all'interno dei task di parallel_for_ (cioè dai thread di OpenCV), né la memoria allocata tramite
+ std::vector o new, come quella di PackedEdgeMap o di BilevelImage.
+ L'allocatore viene installato dal primo PipelineTimer che misura, e l'allocatore precedente viene ripristinato
+ quando termina l'ultimo PipelineTimer ancora attivo: al di fuori delle misure le allocazioni non passano per i
+ contatori. L'allocatore di default di OpenCV è globale, dunque non deve essere sostituito da altro codice mentre
+ una misura è in corso.
+ Le statistiche di un insieme di elaborazioni possono essere esportate nel formato JSON dei trace event di Chrome,
+ visualizzabile con chrome://tracing o Perfetto.
+*/
+
+class StageStats {
+public:
+    std::string name;
+    // Istante di inizio, in millisecondi da trace_clock_ms() == 0, e durata in millisecondi
+    double start_ms = 0;
+    double wall_ms = 0;
+    // Byte delle cv::Mat allocate dal thread della pipeline durante la fase, più la crescita del Workspace
+    size_t tracked_allocated_bytes = 0;
+    // Massimo, durante la fase, della memoria tracciata allocata dalla pipeline e non ancora liberata
+    size_t tracked_peak_bytes = 0;
+};
+
+class PipelineStats {
+public:
+    // Etichetta dell'elaborazione (per esempio il percorso dell'immagine) e thread, utilizzati nella traccia
+    std::string label;
+    int thread = 0;
+
+    std::vector<StageStats> stages;
+    double start_ms = 0;
+    double wall_ms = 0;
+    size_t tracked_allocated_bytes = 0;
+    size_t tracked_peak_bytes = 0;
+    long edge_chase_calls = 0;
+    long edge_chase_pixels = 0;
+
+    void print(FILE* stream) const;
+};
+
+/*
+ StageTimer misura una fase: la misura inizia alla costruzione e termina alla distruzione, o alla chiamata di stop,
+ ed il risultato viene aggiunto a stats->stages. Se stats è nullo non viene misurato nulla.
+ PipelineTimer misura l'intera elaborazione e fissa il livello di memoria rispetto al quale sono calcolati i picchi.
+ Se stats è nullo nemmeno PipelineTimer misura nulla, e l'allocatore non viene installato.
+*/
+
+class PipelineTimer {
+public:
+    PipelineTimer(PipelineStats* stats, const Workspace* workspace);
+    ~PipelineTimer();
+    PipelineTimer(const PipelineTimer &) = delete;
+    PipelineTimer &operator=(const PipelineTimer &) = delete;
+
+    PipelineStats* stats;
+    const Workspace* workspace;
+    long long base_live_bytes = 0;
+    size_t base_workspace_bytes = 0;
+};
+
+class StageTimer {
+public:
+    StageTimer(const PipelineTimer &pipeline, const char* name);
+    ~StageTimer();
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+    void stop();
+
+private:
+    const PipelineTimer &pipeline;
+    StageStats stage;
+    long long start_allocated = 0;
+    size_t start_workspace_bytes = 0;
+    bool running = false;
+};
+
+double trace_clock_ms();
+void write_chrome_trace(const std::vector<PipelineStats> &batch, FILE* stream);
+// Restituisce text come stringa JSON, tra virgolette: le virgolette e le barre rovesciate vengono precedute da una
+// barra rovesciata, ed i caratteri di controllo vengono omessi.
+std::string json_string(const std::string &text);
+
+#endif
@@ -1,28 +1,44 @@
 #include "pre_processing.h"
+#include "median_filter.h"
+#include "pipeline_trace.h"
 #include "opencv2/opencv.hpp"
-
-int PreProcessing::BLUR_KERNEL_SIZE = 51;
-int PreProcessing::THRESHOLD = 30;
-int PreProcessing::HP_KERNEL_SIZE = 11;
+#include <algorithm>
+#include <cstdlib>
 
 /*
  Questa funzione mette insieme i passaggi che costituiscono la fase di pre-processing, il cui scopo
  è preparare l'immagine per l'elaborazione successiva, ovvero l'estrazione della pagina.
 */
 
-Mat pre_process_image(const Mat &input_image) {
+Mat pre_process_image(const Mat &input_image, const PreProcessing &params) {
+    PipelineTimer untimed(nullptr, nullptr);
+    return pre_process_image(input_image, params, untimed);
+}
+
+Mat pre_process_image(const Mat &input_image, const PreProcessing &params, const PipelineTimer &pipeline) {
 
-    Mat output_image = input_image.clone();
+    Mat median_image, gradient_image, output_image;
+
+    // Con GRAYSCALE_FIRST la conversione in grigio, che edge_detection esegue dopo i passa-alto, viene anticipata:
+    // tutte le fasi successive elaborano un solo canale.
+    Mat source;
+    if (params.GRAYSCALE_FIRST && input_image.channels() == 3) cvtColor(input_image, source, COLOR_RGB2GRAY);
+    else source = input_image;
 
     // L'immagine viene filtrata tramite un filtro mediano ad ampia maschera. Questo passaggio, che ha lo scopo
     // di rimuovere dall'immagine le variazioni locali, mantenendo il più possibile evidenti i punti di bordo tra
     // gli oggetti dell'immagine, determina pesantemente l'efficacia dell'estrazione della pagina.
     // Il filtro mediano sfuoca pesantemente il testo scritto all'interno del foglio scannerizzato ed il rumore
     // di bordo, mentre mantiene abbastanza evidenti i bordi del foglio.
-    medianBlur(output_image, output_image, PreProcessing::BLUR_KERNEL_SIZE);
+    // median_filter produce lo stesso risultato di medianBlur, con un costo per pixel che non dipende dalla maschera.
+    StageTimer median_stage(pipeline, "median_blur");
+    median_filter(source, median_image, params.BLUR_KERNEL_SIZE);
+    median_stage.stop();
 
     // Il risultato viene filtrato tramite dei passa-alto per evidenziare i bordi dell'immagine.
-    output_image = edge_detection(output_image);
+    StageTimer edge_stage(pipeline, "edge_detection");
+    edge_detection(median_image, output_image, gradient_image, params);
+    edge_stage.stop();
 
     return output_image;
 }
@@ -30,67 +46,133 @@ Mat pre_process_image(const Mat &input_image) {
 /*
  La seguente funzione risalta i bordi dell'immagine. Questa fase consiste in un filtraggio tramite passa-alto,
  realizzato in 4 passaggi: sinistra -> destra, destra -> sinistra, alto -> basso, basso -> alto.
- La maschera base del kernel è [ -1 0 1 ].
-*/
-
-Mat edge_detection(const Mat &input_image) {
-    // Le maschere dei filtri vengono inizializzate
-    Mat right_left_filter = Mat(1, PreProcessing::HP_KERNEL_SIZE, CV_32S);
-    Mat left_right_filter = Mat(1, PreProcessing::HP_KERNEL_SIZE, CV_32S);
-    Mat top_bottom_filter = Mat(PreProcessing::HP_KERNEL_SIZE, 1, CV_32S);
-    Mat bottom_top_filter = Mat(PreProcessing::HP_KERNEL_SIZE, 1, CV_32S);
-
-    // Sia N la lunghezza del filtro, con N dispari. I primi N/2 coefficienti sono pari a -1,
-    // il coefficiente centrale è pari a 0, ed i successivi N/2 sono pari ad 1.
-    left_right_filter.forEach<int32_t>([] (int32_t &value, const int* p) -> void {
-        if (p[1] < PreProcessing::HP_KERNEL_SIZE/2) value = -1;
-        else if (p[1] > PreProcessing::HP_KERNEL_SIZE/2) value = 1;
-        else value = 0;
-    });
-    right_left_filter.forEach<int32_t>([] (int32_t &value, const int* p) -> void {
-        if (p[1] < PreProcessing::HP_KERNEL_SIZE/2) value = 1;
-        else if (p[1] > PreProcessing::HP_KERNEL_SIZE/2) value = -1;
-        else value = 0;
-    });
-    top_bottom_filter.forEach<int32_t>([] (int32_t &value, const int* p) -> void {
-        if (p[0] < PreProcessing::HP_KERNEL_SIZE/2) value = -1;
-        else if (p[0] > PreProcessing::HP_KERNEL_SIZE/2) value = 1;
-        else value = 0;
-    });
-    bottom_top_filter.forEach<int32_t>([] (int32_t &value, const int* p) -> void {
-        if (p[0] < PreProcessing::HP_KERNEL_SIZE/2) value = 1;
-        else if (p[0] > PreProcessing::HP_KERNEL_SIZE/2) value = -1;
-        else value = 0;
-    });
-
-    // Le matrici contenenti i risultati delle convoluzioni
-    Mat right_left_output = Mat::zeros(input_image.size(), CV_32F);
-    Mat left_right_output = Mat::zeros(input_image.size(), CV_32F);
-    Mat top_bottom_output = Mat::zeros(input_image.size(), CV_32F);
-    Mat bottom_top_output = Mat::zeros(input_image.size(), CV_32F);
-    Mat filtered_image = Mat::zeros(input_image.size(), 0);
+ La maschera base del kernel è [ -1 0 1 ]: sia N la lunghezza del filtro, i primi N/2 coefficienti sono pari a -1,
+ il coefficiente centrale è pari a 0, ed i successivi sono pari ad 1.
 
-    // I filtri vengono applicati
-    filter2D(input_image, left_right_output, -1, left_right_filter, Point(-1, -1), 0, BORDER_DEFAULT);
-    filter2D(input_image, right_left_output, -1, right_left_filter, Point(-1, -1), 0, BORDER_DEFAULT);
-    filter2D(input_image, top_bottom_output, -1, top_bottom_filter, Point(-1, -1), 0, BORDER_DEFAULT);
-    filter2D(input_image, bottom_top_output, -1, bottom_top_filter, Point(-1, -1), 0, BORDER_DEFAULT);
+ I quattro passaggi sono calcolati da gradient_magnitude in un'unica passata, la cui complessità non dipende da N.
+*/
 
-    // I risultati delle convoluzioni sono tra loro sommati
-    filtered_image = left_right_output+right_left_output+top_bottom_output+bottom_top_output;
-    if (filtered_image.channels() == 3) cvtColor(filtered_image, filtered_image, COLOR_RGB2GRAY);
+Mat edge_detection(const Mat &input_image, const PreProcessing &params) {
+    Mat edge_image, gradient_image;
+    edge_detection(input_image, edge_image, gradient_image, params);
+    return edge_image;
+}
 
-    // Le matrici non più necessarie sono deallocate
-    left_right_output.deallocate(); right_left_output.deallocate(); top_bottom_output.deallocate(); bottom_top_output.deallocate();
-    left_right_filter.deallocate(); right_left_filter.deallocate(); top_bottom_filter.deallocate(); bottom_top_filter.deallocate();
+void edge_detection(const Mat &input_image, Mat &edge_image, Mat &gradient_image, const PreProcessing &params) {
+    if (input_image.channels() == 3) {
+        gradient_magnitude(input_image, gradient_image, params.HP_KERNEL_SIZE);
+        edge_image.create(input_image.size[0], input_image.size[1], CV_8U);
+        cvtColor(gradient_image, edge_image, COLOR_RGB2GRAY);
+    }
+    else {
+        gradient_magnitude(input_image, edge_image, params.HP_KERNEL_SIZE);
+    }
 
     // Il risultato viene filtrato tramite un passa-basso, e successivamente binarizzato applicando una soglia.
     // Queste due operazioni hanno l'effetto di ripulire l'immagine filtrata da "falsi" bordi, e di inspessire i bordi
     // reali.
-    GaussianBlur(filtered_image, filtered_image, Size(PreProcessing::BLUR_KERNEL_SIZE, PreProcessing::BLUR_KERNEL_SIZE), 0, 0);
-    threshold(filtered_image, filtered_image, PreProcessing::THRESHOLD, 255, THRESH_BINARY);
+    GaussianBlur(edge_image, edge_image, Size(params.BLUR_KERNEL_SIZE, params.BLUR_KERNEL_SIZE), 0, 0);
+    threshold(edge_image, edge_image, params.THRESHOLD, 255, THRESH_BINARY);
+}
+
+/*
+ Ciascuno dei quattro filtri passa-alto è la differenza tra la somma dei pixel che seguono e quella dei pixel che
+ precedono il pixel centrale, lungo una direzione. Il filtro destra -> sinistra è l'opposto del filtro
+ sinistra -> destra, ed i risultati dei filtri erano saturati in [0, 255] prima di essere sommati: la somma dei
+ quattro passaggi vale dunque min(|Dx| + |Dy|, 255), dove Dx e Dy sono le risposte dei filtri sinistra -> destra ed
+ alto -> basso. Ai bordi l'immagine viene riflessa come con BORDER_DEFAULT.
+
+ Dy è calcolata mantenendo, per ogni colonna, la somma delle N/2 righe che precedono la riga corrente e quella delle
+ righe che la seguono: passando alla riga successiva ogni somma viene aggiornata con una sola addizione ed una sola
+ sottrazione. Dx è calcolata tramite le somme cumulative lungo la riga, estesa ai bordi per riflessione.
+ Il costo per pixel è quindi costante, qualunque sia la lunghezza del filtro. |Dx| e |Dy|, saturati a 255, sono
+ mantenuti in buffer di una riga ad interi a 16 bit, la cui somma non può superare 510.
+*/
+
+static void gradient_magnitude_rows(const Mat &input_image, Mat &gradient_image, int before, int after,
+                                    int row_begin, int row_end) {
+    int rows = input_image.size[0], cols = input_image.size[1];
+    int channels = input_image.channels();
+    int width = cols*channels;
+    int padded_width = (cols+before+after)*channels;
+
+    int32_t above_sum[width], below_sum[width];
+    int32_t row_prefix[padded_width+channels];
+    int16_t horizontal[width], vertical[width];
+
+    for (int i=0; i<width; ++i) {
+        above_sum[i] = 0;
+        below_sum[i] = 0;
+    }
+    for (int d=1; d<=before; ++d) {
+        const unsigned char* row = input_image.ptr<unsigned char>(borderInterpolate(row_begin-d, rows, BORDER_DEFAULT));
+        for (int i=0; i<width; ++i) above_sum[i] += row[i];
+    }
+    for (int d=1; d<=after; ++d) {
+        const unsigned char* row = input_image.ptr<unsigned char>(borderInterpolate(row_begin+d, rows, BORDER_DEFAULT));
+        for (int i=0; i<width; ++i) below_sum[i] += row[i];
+    }
+
+    for (int y=row_begin; y<row_end; ++y) {
+        const unsigned char* row = input_image.ptr<unsigned char>(y);
+        if (y != row_begin) {
+            const unsigned char* previous = input_image.ptr<unsigned char>(y-1);
+            const unsigned char* above_outgoing = input_image.ptr<unsigned char>(borderInterpolate(y-1-before, rows, BORDER_DEFAULT));
+            const unsigned char* below_incoming = input_image.ptr<unsigned char>(borderInterpolate(y+after, rows, BORDER_DEFAULT));
+            for (int i=0; i<width; ++i) {
+                above_sum[i] += previous[i] - above_outgoing[i];
+                below_sum[i] += below_incoming[i] - row[i];
+            }
+        }
+        for (int i=0; i<width; ++i) {
+            vertical[i] = (int16_t) std::min(std::abs(below_sum[i] - above_sum[i]), 255);
+        }
+
+        // row_prefix[(p+1) x channels + c] è la somma dei pixel della riga estesa con indice minore o uguale a p, dove
+        // il pixel di indice p corrisponde alla colonna p - before.
+        for (int c=0; c<channels; ++c) row_prefix[c] = 0;
+        for (int p=0; p<cols+before+after; ++p) {
+            const unsigned char* pixel = row + borderInterpolate(p-before, cols, BORDER_DEFAULT)*channels;
+            for (int c=0; c<channels; ++c) {
+                row_prefix[(p+1)*channels + c] = row_prefix[p*channels + c] + pixel[c];
+            }
+        }
+        for (int i=0; i<width; ++i) {
+            int q = i + before*channels;
+            int right = row_prefix[q + (after+1)*channels] - row_prefix[q + channels];
+            int left = row_prefix[q] - row_prefix[q - before*channels];
+            horizontal[i] = (int16_t) std::min(std::abs(right - left), 255);
+        }
+
+        unsigned char* output = gradient_image.ptr<unsigned char>(y);
+        for (int i=0; i<width; ++i) {
+            output[i] = (unsigned char) std::min(horizontal[i] + vertical[i], 255);
+        }
+    }
+}
 
-    return filtered_image;
+void gradient_magnitude(const Mat &input_image, Mat &gradient_image, int hp_kernel_size) {
+    if (input_image.depth() != CV_8U) {
+        std::cerr<<"pre_processing.gradient_magnitude(): The image must be an 8 bit image\n";
+        exit(1);
+    }
+    if (hp_kernel_size < 1) {
+        std::cerr<<"pre_processing.gradient_magnitude(): The kernel size must be positive\n";
+        exit(1);
+    }
+    int rows = input_image.size[0];
+    int before = hp_kernel_size/2, after = hp_kernel_size - 1 - before;
+    gradient_image.create(input_image.size[0], input_image.size[1], input_image.type());
+
+    // Le fasce orizzontali sono elaborate in parallelo; ogni fascia inizializza le proprie somme lungo le colonne.
+    int bands = std::max(1, std::min(getNumThreads(), rows/hp_kernel_size));
+    parallel_for_(Range(0, bands), [&] (const Range &range) -> void {
+        for (int band=range.start; band<range.end; ++band) {
+            int band_begin = (int) ((long) rows * band / bands);
+            int band_end = (int) ((long) rows * (band+1) / bands);
+            gradient_magnitude_rows(input_image, gradient_image, before, after, band_begin, band_end);
+        }
+    });
 }
 
 PreProcessing::PreProcessing(int blur_kernel_size, int threshold) {
@@ -98,4 +180,10 @@ PreProcessing::PreProcessing(int blur_kernel_size, int threshold) {
     THRESHOLD = threshold;
 }
 
+PreProcessing::PreProcessing(int blur_kernel_size, int threshold, int hp_kernel_size) {
+    BLUR_KERNEL_SIZE = blur_kernel_size;
+    THRESHOLD = threshold;
+    HP_KERNEL_SIZE = hp_kernel_size;
+}
+
 
@@ -1,26 +1,45 @@
 #ifndef SERVER_APP_PRE_PROCESSING_H
 #define SERVER_APP_PRE_PROCESSING_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
+class PipelineTimer;
+
 /*
  Questo modulo contiene il codice coinvolto nella fase di pre-processing.
  La classe PreProcessing contiene i parametri del modulo, ed esporta un costruttore per inizializzarne
- comodamente i valori.
+ comodamente i valori. Un oggetto PreProcessing viene passato per riferimento costante alle funzioni del modulo,
+ in modo che elaborazioni con parametri diversi possano essere eseguite in parallelo.
 */
 
 class PreProcessing {
 
 public:
-    static int BLUR_KERNEL_SIZE;
-    static int THRESHOLD;
-    static int HP_KERNEL_SIZE;
+    int BLUR_KERNEL_SIZE = 51;
+    int THRESHOLD = 30;
+    int HP_KERNEL_SIZE = 11;
+    // Se vero, un'immagine a colori viene convertita in grigio prima del filtro mediano, ed il pre-processing lavora
+    // su un solo canale. Il costo del filtro mediano e dei passa-alto si riduce di circa tre volte, ma l'immagine
+    // filtrata, e quindi la cornice, può differire da quella calcolata sui tre canali (vedi grayscale_comparison).
+    bool GRAYSCALE_FIRST = false;
 
+    PreProcessing() = default;
     explicit PreProcessing(int blur_kernel_size, int threshold);
+    explicit PreProcessing(int blur_kernel_size, int threshold, int hp_kernel_size);
 };
 
-Mat pre_process_image(const Mat &input_image);
-Mat edge_detection(const Mat &input_image);
+Mat pre_process_image(const Mat &input_image, const PreProcessing &params = PreProcessing());
+// Lo stesso pre-processing, con le fasi median_blur ed edge_detection misurate separatamente da pipeline.
+Mat pre_process_image(const Mat &input_image, const PreProcessing &params, const PipelineTimer &pipeline);
+Mat edge_detection(const Mat &input_image, const PreProcessing &params = PreProcessing());
+// Scrive la maschera dei bordi in edge_image, di tipo CV_8U, che viene riallocata solo se le dimensioni cambiano.
+// Per un'immagine a colori i gradienti dei tre canali sono calcolati in gradient_image, anch'essa riutilizzata; per
+// un'immagine in grigio gradient_image non viene utilizzata. Nessuna delle due può condividere i dati con input_image.
+void edge_detection(const Mat &input_image, Mat &edge_image, Mat &gradient_image,
+                    const PreProcessing &params = PreProcessing());
+// Somma delle risposte, saturate, dei quattro filtri passa-alto di lunghezza hp_kernel_size utilizzati da
+// edge_detection, calcolata canale per canale. gradient_image non può condividere i dati con input_image.
+void gradient_magnitude(const Mat &input_image, Mat &gradient_image, int hp_kernel_size);
+
+#endif
@@ -0,0 +1,63 @@
+#include "run_length_index.h"
+#include "page_frame.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using namespace cv;
+
+/*
+ Le sequenze orizzontali sono calcolate riga per riga: per W_E la riga viene percorsa da destra verso sinistra, ed
+ ogni pixel bianco vale uno più il pixel alla sua destra; per E_W la riga viene percorsa nel verso opposto.
+ Le sequenze verticali sono calcolate in modo analogo, una riga alla volta, a partire dalla riga adiacente già
+ calcolata: in questo modo anche le passate verticali leggono la memoria in modo sequenziale. Le righe sono divise
+ in fasce verticali elaborate in parallelo.
+*/
+
+RunLengthIndex::RunLengthIndex(const Mat &filtered_image) {
+    int rows = filtered_image.size[0], cols = filtered_image.size[1];
+    for (auto &plane : runs) plane.create(rows, cols, CV_16U);
+
+    parallel_for_(Range(0, rows), [&] (const Range &range) -> void {
+        for (int row=range.start; row<range.end; ++row) {
+            const unsigned char* pixels = filtered_image.ptr<unsigned char>(row);
+            uint16_t* west_east = runs[W_E].ptr<uint16_t>(row);
+            uint16_t* east_west = runs[E_W].ptr<uint16_t>(row);
+            int run = 0;
+            for (int col=cols-1; col>=0; --col) {
+                run = pixels[col] ? std::min(run + 1, 65535) : 0;
+                west_east[col] = (uint16_t) run;
+            }
+            run = 0;
+            for (int col=0; col<cols; ++col) {
+                run = pixels[col] ? std::min(run + 1, 65535) : 0;
+                east_west[col] = (uint16_t) run;
+            }
+        }
+    });
+
+    int strips = std::max(1, std::min(getNumThreads(), cols / 64));
+    parallel_for_(Range(0, strips), [&] (const Range &range) -> void {
+        for (int strip=range.start; strip<range.end; ++strip) {
+            int col_begin = (int) ((long) cols * strip / strips), col_end = (int) ((long) cols * (strip+1) / strips);
+            for (int row=rows-1; row>=0; --row) {
+                const unsigned char* pixels = filtered_image.ptr<unsigned char>(row);
+                uint16_t* north_south = runs[N_S].ptr<uint16_t>(row);
+                const uint16_t* below = row+1 < rows ? runs[N_S].ptr<uint16_t>(row+1) : nullptr;
+                for (int col=col_begin; col<col_end; ++col) {
+                    int run = below ? below[col] : 0;
+                    north_south[col] = pixels[col] ? (uint16_t) std::min(run + 1, 65535) : 0;
+                }
+            }
+            for (int row=0; row<rows; ++row) {
+                const unsigned char* pixels = filtered_image.ptr<unsigned char>(row);
+                uint16_t* south_north = runs[S_N].ptr<uint16_t>(row);
+                const uint16_t* above = row > 0 ? runs[S_N].ptr<uint16_t>(row-1) : nullptr;
+                for (int col=col_begin; col<col_end; ++col) {
+                    int run = above ? above[col] : 0;
+                    south_north[col] = pixels[col] ? (uint16_t) std::min(run + 1, 65535) : 0;
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,34 @@
+#ifndef SERVER_APP_RUN_LENGTH_INDEX_H
+#define SERVER_APP_RUN_LENGTH_INDEX_H
+
+#include "opencv2/opencv.hpp"
+#include "page_frame.h"
+using namespace cv;
+
+/*
+ Questo modulo contiene un indice delle sequenze di pixel bianchi dell'immagine filtrata. Per ogni pixel e per
+ ciascuna delle quattro direzioni W_E, E_W, N_S ed S_N, l'indice contiene il numero di pixel bianchi consecutivi che
+ si incontrano partendo da quel pixel (compreso) e muovendosi in quella direzione, fino al primo pixel nero o al
+ bordo dell'immagine. I valori sono saturati a 65535.
+ Con l'indice, edge_chase stabilisce in tempo costante l'esito dell'inseguimento di una retta perfettamente
+ orizzontale o verticale. Solo le rette inclinate devono ancora essere percorse pixel per pixel.
+ L'indice occupa 8 byte per pixel e viene costruito in quattro passate parallele sull'immagine.
+*/
+
+class RunLengthIndex {
+public:
+    explicit RunLengthIndex(const Mat &filtered_image);
+
+    bool contains(int row, int col) const {
+        return row >= 0 && col >= 0 && row < runs[0].size[0] && col < runs[0].size[1];
+    }
+    int run_length(int row, int col, int direction) const {
+        return runs[direction].at<uint16_t>(row, col);
+    }
+
+private:
+    // Una matrice CV_16U per direzione, indicizzata da W_E, E_W, N_S ed S_N
+    Mat runs[4];
+};
+
+#endif
@@ -0,0 +1,467 @@
+#include "statistics_kernels.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STATS_KERNELS_X86
+#endif
+
+using namespace cv;
+
+/*
+ Versioni scalari. Le somme mobili orizzontali sono a 64 bit, come nella versione originale di block_stats, quindi
+ queste funzioni sono corrette per qualsiasi dimensione della finestra.
+*/
+
+static void column_sums_update_scalar(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                      int width) {
+    if (outgoing) {
+        for (int j=0; j<width; ++j) sums[j] += incoming[j] - outgoing[j];
+    }
+    else {
+        for (int j=0; j<width; ++j) sums[j] += incoming[j];
+    }
+}
+
+static void column_stats_update_scalar(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                       int32_t* squares_sums, int width) {
+    int in_value, out_value;
+    for (int j=0; j<width; ++j) {
+        in_value = incoming[j];
+        out_value = outgoing ? outgoing[j] : 0;
+        sums[j] += in_value - out_value;
+        squares_sums[j] += in_value*in_value - out_value*out_value;
+    }
+}
+
+static void window_row_mean_scalar(const int32_t* sums, int block_size, int x_begin, int x_end,
+                                   unsigned char* mean_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    long int moving_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) moving_sum += sums[k];
+
+    for (int j=x_begin; j<x_end; ++j) {
+        if (j != x_begin) moving_sum += sums[j+offset] - sums[j-offset-1];
+        mean_row[j] = (unsigned char) ((float) moving_sum / (float) block_area);
+    }
+}
+
+static void window_row_stats_scalar(const int32_t* sums, const int32_t* squares_sums, int block_size, int x_begin,
+                                    int x_end, unsigned char* mean_row, float* var_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    long int moving_sum = 0, moving_squares_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) {
+        moving_sum += sums[k];
+        moving_squares_sum += squares_sums[k];
+    }
+
+    float mean;
+    for (int j=x_begin; j<x_end; ++j) {
+        if (j != x_begin) {
+            moving_sum += sums[j+offset] - sums[j-offset-1];
+            moving_squares_sum += squares_sums[j+offset] - squares_sums[j-offset-1];
+        }
+        mean = (float) moving_sum / (float) block_area;
+        mean_row[j] = (unsigned char) mean;
+        var_row[j] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+    }
+}
+
+#ifdef STATS_KERNELS_X86
+
+/*
+ Versioni SSE4.1 ed AVX2.
+ Nell'aggiornamento delle somme lungo le colonne i pixel entranti ed uscenti vengono intercalati a 16 bit, in modo
+ che una sola istruzione madd calcoli a 32 bit sia la differenza in - out (moltiplicando per [1, -1]) sia la
+ differenza dei quadrati in^2 - out^2 (moltiplicando per [in, -out]).
+ Nel calcolo delle somme mobili orizzontali, le somme relative a più colonne consecutive sono ottenute come somme
+ prefisse delle differenze sums[j + offset] - sums[j - offset - 1], a cui si aggiunge la somma mobile precedente.
+ Le conversioni a float, le divisioni ed i prodotti sono le stesse operazioni IEEE della versione scalare, dunque
+ il risultato è identico bit per bit.
+*/
+
+__attribute__((target("sse4.1")))
+static void column_stats_update_sse41(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                      int32_t* squares_sums, int width) {
+    const __m128i plus_minus = _mm_setr_epi16(1, -1, 1, -1, 1, -1, 1, -1);
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    for (; j+8<=width; j+=8) {
+        __m128i in_values = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (incoming + j)));
+        __m128i out_values = outgoing ? _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (outgoing + j))) : zero;
+        __m128i negated_out = _mm_sub_epi16(zero, out_values);
+
+        __m128i pairs_lo = _mm_unpacklo_epi16(in_values, out_values);
+        __m128i pairs_hi = _mm_unpackhi_epi16(in_values, out_values);
+        __m128i weights_lo = _mm_unpacklo_epi16(in_values, negated_out);
+        __m128i weights_hi = _mm_unpackhi_epi16(in_values, negated_out);
+
+        auto sums_ptr = (__m128i*) (sums + j);
+        auto squares_ptr = (__m128i*) (squares_sums + j);
+        _mm_storeu_si128(sums_ptr, _mm_add_epi32(_mm_loadu_si128(sums_ptr), _mm_madd_epi16(pairs_lo, plus_minus)));
+        _mm_storeu_si128(sums_ptr + 1, _mm_add_epi32(_mm_loadu_si128(sums_ptr + 1), _mm_madd_epi16(pairs_hi, plus_minus)));
+        _mm_storeu_si128(squares_ptr, _mm_add_epi32(_mm_loadu_si128(squares_ptr), _mm_madd_epi16(pairs_lo, weights_lo)));
+        _mm_storeu_si128(squares_ptr + 1, _mm_add_epi32(_mm_loadu_si128(squares_ptr + 1), _mm_madd_epi16(pairs_hi, weights_hi)));
+    }
+    column_stats_update_scalar(outgoing ? outgoing + j : nullptr, incoming + j, sums + j, squares_sums + j, width - j);
+}
+
+__attribute__((target("sse4.1")))
+static void column_sums_update_sse41(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                     int width) {
+    const __m128i plus_minus = _mm_setr_epi16(1, -1, 1, -1, 1, -1, 1, -1);
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    for (; j+8<=width; j+=8) {
+        __m128i in_values = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (incoming + j)));
+        __m128i out_values = outgoing ? _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (outgoing + j))) : zero;
+        auto sums_ptr = (__m128i*) (sums + j);
+        _mm_storeu_si128(sums_ptr, _mm_add_epi32(_mm_loadu_si128(sums_ptr),
+                                                 _mm_madd_epi16(_mm_unpacklo_epi16(in_values, out_values), plus_minus)));
+        _mm_storeu_si128(sums_ptr + 1, _mm_add_epi32(_mm_loadu_si128(sums_ptr + 1),
+                                                     _mm_madd_epi16(_mm_unpackhi_epi16(in_values, out_values), plus_minus)));
+    }
+    column_sums_update_scalar(outgoing ? outgoing + j : nullptr, incoming + j, sums + j, width - j);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i prefix_sum_sse41(__m128i x) {
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    return _mm_add_epi32(x, _mm_slli_si128(x, 8));
+}
+
+__attribute__((target("sse4.1")))
+static inline void store_means_sse41(__m128 mean, unsigned char* destination) {
+    __m128i values = _mm_cvttps_epi32(mean);
+    values = _mm_packus_epi32(values, values);
+    values = _mm_packus_epi16(values, values);
+    int packed = _mm_cvtsi128_si32(values);
+    memcpy(destination, &packed, 4);
+}
+
+__attribute__((target("sse4.1")))
+static void window_row_mean_sse41(const int32_t* sums, int block_size, int x_begin, int x_end,
+                                  unsigned char* mean_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    const __m128 area = _mm_set1_ps((float) block_area);
+    int32_t moving_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) moving_sum += sums[k];
+    mean_row[x_begin] = (unsigned char) ((float) moving_sum / (float) block_area);
+
+    int j = x_begin + 1;
+    __m128i carry = _mm_set1_epi32(moving_sum);
+    for (; j+4<=x_end; j+=4) {
+        __m128i delta = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (sums + j + offset)),
+                                      _mm_loadu_si128((const __m128i*) (sums + j - offset - 1)));
+        __m128i window_sums = _mm_add_epi32(prefix_sum_sse41(delta), carry);
+        carry = _mm_shuffle_epi32(window_sums, 0xFF);
+        store_means_sse41(_mm_div_ps(_mm_cvtepi32_ps(window_sums), area), mean_row + j);
+    }
+    moving_sum = _mm_cvtsi128_si32(carry);
+
+    for (; j<x_end; ++j) {
+        moving_sum += sums[j+offset] - sums[j-offset-1];
+        mean_row[j] = (unsigned char) ((float) moving_sum / (float) block_area);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void window_row_stats_sse41(const int32_t* sums, const int32_t* squares_sums, int block_size, int x_begin,
+                                   int x_end, unsigned char* mean_row, float* var_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    const __m128 area = _mm_set1_ps((float) block_area);
+    int32_t moving_sum = 0, moving_squares_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) {
+        moving_sum += sums[k];
+        moving_squares_sum += squares_sums[k];
+    }
+    float mean = (float) moving_sum / (float) block_area;
+    mean_row[x_begin] = (unsigned char) mean;
+    var_row[x_begin] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+
+    int j = x_begin + 1;
+    __m128i carry = _mm_set1_epi32(moving_sum);
+    __m128i squares_carry = _mm_set1_epi32(moving_squares_sum);
+    for (; j+4<=x_end; j+=4) {
+        __m128i delta = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (sums + j + offset)),
+                                      _mm_loadu_si128((const __m128i*) (sums + j - offset - 1)));
+        __m128i squares_delta = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (squares_sums + j + offset)),
+                                              _mm_loadu_si128((const __m128i*) (squares_sums + j - offset - 1)));
+        __m128i window_sums = _mm_add_epi32(prefix_sum_sse41(delta), carry);
+        __m128i window_squares_sums = _mm_add_epi32(prefix_sum_sse41(squares_delta), squares_carry);
+        carry = _mm_shuffle_epi32(window_sums, 0xFF);
+        squares_carry = _mm_shuffle_epi32(window_squares_sums, 0xFF);
+
+        __m128 means = _mm_div_ps(_mm_cvtepi32_ps(window_sums), area);
+        __m128 vars = _mm_sub_ps(_mm_div_ps(_mm_cvtepi32_ps(window_squares_sums), area), _mm_mul_ps(means, means));
+        store_means_sse41(means, mean_row + j);
+        _mm_storeu_ps(var_row + j, vars);
+    }
+    moving_sum = _mm_cvtsi128_si32(carry);
+    moving_squares_sum = _mm_cvtsi128_si32(squares_carry);
+
+    for (; j<x_end; ++j) {
+        moving_sum += sums[j+offset] - sums[j-offset-1];
+        moving_squares_sum += squares_sums[j+offset] - squares_sums[j-offset-1];
+        mean = (float) moving_sum / (float) block_area;
+        mean_row[j] = (unsigned char) mean;
+        var_row[j] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+    }
+}
+
+__attribute__((target("avx2")))
+static void column_stats_update_avx2(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                     int32_t* squares_sums, int width) {
+    // Coppie di interi a 16 bit [1, -1]
+    const __m256i plus_minus = _mm256_set1_epi32((int) 0xFFFF0001);
+    const __m256i zero = _mm256_setzero_si256();
+    int j = 0;
+    for (; j+16<=width; j+=16) {
+        __m256i in_values = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (incoming + j)));
+        __m256i out_values = outgoing ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (outgoing + j))) : zero;
+        __m256i negated_out = _mm256_sub_epi16(zero, out_values);
+
+        // unpacklo/unpackhi operano separatamente sulle due metà a 128 bit: i risultati contengono le colonne
+        // [0..3 | 8..11] e [4..7 | 12..15], e vengono riordinati con permute2x128.
+        __m256i pairs_lo = _mm256_unpacklo_epi16(in_values, out_values);
+        __m256i pairs_hi = _mm256_unpackhi_epi16(in_values, out_values);
+        __m256i differences_lo = _mm256_madd_epi16(pairs_lo, plus_minus);
+        __m256i differences_hi = _mm256_madd_epi16(pairs_hi, plus_minus);
+        __m256i squares_lo = _mm256_madd_epi16(pairs_lo, _mm256_unpacklo_epi16(in_values, negated_out));
+        __m256i squares_hi = _mm256_madd_epi16(pairs_hi, _mm256_unpackhi_epi16(in_values, negated_out));
+
+        auto sums_ptr = (__m256i*) (sums + j);
+        auto squares_ptr = (__m256i*) (squares_sums + j);
+        _mm256_storeu_si256(sums_ptr, _mm256_add_epi32(_mm256_loadu_si256(sums_ptr),
+                                                       _mm256_permute2x128_si256(differences_lo, differences_hi, 0x20)));
+        _mm256_storeu_si256(sums_ptr + 1, _mm256_add_epi32(_mm256_loadu_si256(sums_ptr + 1),
+                                                           _mm256_permute2x128_si256(differences_lo, differences_hi, 0x31)));
+        _mm256_storeu_si256(squares_ptr, _mm256_add_epi32(_mm256_loadu_si256(squares_ptr),
+                                                          _mm256_permute2x128_si256(squares_lo, squares_hi, 0x20)));
+        _mm256_storeu_si256(squares_ptr + 1, _mm256_add_epi32(_mm256_loadu_si256(squares_ptr + 1),
+                                                              _mm256_permute2x128_si256(squares_lo, squares_hi, 0x31)));
+    }
+    column_stats_update_scalar(outgoing ? outgoing + j : nullptr, incoming + j, sums + j, squares_sums + j, width - j);
+}
+
+__attribute__((target("avx2")))
+static void column_sums_update_avx2(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                                    int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    int j = 0;
+    for (; j+16<=width; j+=16) {
+        __m256i in_values = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (incoming + j)));
+        __m256i out_values = outgoing ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (outgoing + j))) : zero;
+        // Le differenze sono comprese in [-255, 255], quindi possono essere calcolate a 16 bit ed estese a 32.
+        __m256i differences = _mm256_sub_epi16(in_values, out_values);
+        auto sums_ptr = (__m256i*) (sums + j);
+        _mm256_storeu_si256(sums_ptr, _mm256_add_epi32(_mm256_loadu_si256(sums_ptr),
+                                                       _mm256_cvtepi16_epi32(_mm256_castsi256_si128(differences))));
+        _mm256_storeu_si256(sums_ptr + 1, _mm256_add_epi32(_mm256_loadu_si256(sums_ptr + 1),
+                                                           _mm256_cvtepi16_epi32(_mm256_extracti128_si256(differences, 1))));
+    }
+    column_sums_update_scalar(outgoing ? outgoing + j : nullptr, incoming + j, sums + j, width - j);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i prefix_sum_avx2(__m256i x) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    // Le due metà a 128 bit sono state sommate separatamente: alla metà alta va aggiunto l'ultimo elemento della bassa
+    __m256i low_total = _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3));
+    return _mm256_add_epi32(x, _mm256_blend_epi32(_mm256_setzero_si256(), low_total, 0xF0));
+}
+
+__attribute__((target("avx2")))
+static inline void store_means_avx2(__m256 mean, unsigned char* destination) {
+    __m256i values = _mm256_cvttps_epi32(mean);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+    _mm_storel_epi64((__m128i*) destination, _mm_packus_epi16(packed, packed));
+}
+
+__attribute__((target("avx2")))
+static void window_row_mean_avx2(const int32_t* sums, int block_size, int x_begin, int x_end,
+                                 unsigned char* mean_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    const __m256 area = _mm256_set1_ps((float) block_area);
+    const __m256i last = _mm256_set1_epi32(7);
+    int32_t moving_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) moving_sum += sums[k];
+    mean_row[x_begin] = (unsigned char) ((float) moving_sum / (float) block_area);
+
+    int j = x_begin + 1;
+    __m256i carry = _mm256_set1_epi32(moving_sum);
+    for (; j+8<=x_end; j+=8) {
+        __m256i delta = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (sums + j + offset)),
+                                         _mm256_loadu_si256((const __m256i*) (sums + j - offset - 1)));
+        __m256i window_sums = _mm256_add_epi32(prefix_sum_avx2(delta), carry);
+        carry = _mm256_permutevar8x32_epi32(window_sums, last);
+        store_means_avx2(_mm256_div_ps(_mm256_cvtepi32_ps(window_sums), area), mean_row + j);
+    }
+    moving_sum = _mm256_cvtsi256_si32(carry);
+
+    for (; j<x_end; ++j) {
+        moving_sum += sums[j+offset] - sums[j-offset-1];
+        mean_row[j] = (unsigned char) ((float) moving_sum / (float) block_area);
+    }
+}
+
+__attribute__((target("avx2")))
+static void window_row_stats_avx2(const int32_t* sums, const int32_t* squares_sums, int block_size, int x_begin,
+                                  int x_end, unsigned char* mean_row, float* var_row) {
+    int offset = block_size/2;
+    int block_area = block_size*block_size;
+    const __m256 area = _mm256_set1_ps((float) block_area);
+    const __m256i last = _mm256_set1_epi32(7);
+    int32_t moving_sum = 0, moving_squares_sum = 0;
+    for (int k=x_begin-offset; k<=x_begin+offset; ++k) {
+        moving_sum += sums[k];
+        moving_squares_sum += squares_sums[k];
+    }
+    float mean = (float) moving_sum / (float) block_area;
+    mean_row[x_begin] = (unsigned char) mean;
+    var_row[x_begin] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+
+    int j = x_begin + 1;
+    __m256i carry = _mm256_set1_epi32(moving_sum);
+    __m256i squares_carry = _mm256_set1_epi32(moving_squares_sum);
+    for (; j+8<=x_end; j+=8) {
+        __m256i delta = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (sums + j + offset)),
+                                         _mm256_loadu_si256((const __m256i*) (sums + j - offset - 1)));
+        __m256i squares_delta = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (squares_sums + j + offset)),
+                                                 _mm256_loadu_si256((const __m256i*) (squares_sums + j - offset - 1)));
+        __m256i window_sums = _mm256_add_epi32(prefix_sum_avx2(delta), carry);
+        __m256i window_squares_sums = _mm256_add_epi32(prefix_sum_avx2(squares_delta), squares_carry);
+        carry = _mm256_permutevar8x32_epi32(window_sums, last);
+        squares_carry = _mm256_permutevar8x32_epi32(window_squares_sums, last);
+
+        __m256 means = _mm256_div_ps(_mm256_cvtepi32_ps(window_sums), area);
+        __m256 vars = _mm256_sub_ps(_mm256_div_ps(_mm256_cvtepi32_ps(window_squares_sums), area),
+                                    _mm256_mul_ps(means, means));
+        store_means_avx2(means, mean_row + j);
+        _mm256_storeu_ps(var_row + j, vars);
+    }
+    moving_sum = _mm256_cvtsi256_si32(carry);
+    moving_squares_sum = _mm256_cvtsi256_si32(squares_carry);
+
+    for (; j<x_end; ++j) {
+        moving_sum += sums[j+offset] - sums[j-offset-1];
+        moving_squares_sum += squares_sums[j+offset] - squares_sums[j-offset-1];
+        mean = (float) moving_sum / (float) block_area;
+        mean_row[j] = (unsigned char) mean;
+        var_row[j] = ((float) moving_squares_sum / (float) block_area) - mean*mean;
+    }
+}
+
+#endif
+
+/*
+ La tabella dei kernel in uso. Viene inizializzata al primo utilizzo con la versione migliore supportata dalla CPU.
+*/
+
+class StatisticsKernels {
+public:
+    int isa = STATS_ISA_SCALAR;
+    void (*sums_update) (const unsigned char*, const unsigned char*, int32_t*, int) = column_sums_update_scalar;
+    void (*stats_update) (const unsigned char*, const unsigned char*, int32_t*, int32_t*, int) = column_stats_update_scalar;
+    void (*row_mean) (const int32_t*, int, int, int, unsigned char*) = window_row_mean_scalar;
+    void (*row_stats) (const int32_t*, const int32_t*, int, int, int, unsigned char*, float*) = window_row_stats_scalar;
+};
+
+static int supported_isa() {
+#ifdef STATS_KERNELS_X86
+    if (checkHardwareSupport(CV_CPU_AVX2)) return STATS_ISA_AVX2;
+    if (checkHardwareSupport(CV_CPU_SSE4_1)) return STATS_ISA_SSE4_1;
+#endif
+    return STATS_ISA_SCALAR;
+}
+
+static StatisticsKernels make_kernels(int isa) {
+    StatisticsKernels kernels;
+    isa = std::min(isa, supported_isa());
+#ifdef STATS_KERNELS_X86
+    if (isa == STATS_ISA_AVX2) {
+        kernels.sums_update = column_sums_update_avx2;
+        kernels.stats_update = column_stats_update_avx2;
+        kernels.row_mean = window_row_mean_avx2;
+        kernels.row_stats = window_row_stats_avx2;
+    }
+    else if (isa == STATS_ISA_SSE4_1) {
+        kernels.sums_update = column_sums_update_sse41;
+        kernels.stats_update = column_stats_update_sse41;
+        kernels.row_mean = window_row_mean_sse41;
+        kernels.row_stats = window_row_stats_sse41;
+    }
+    else isa = STATS_ISA_SCALAR;
+#else
+    isa = STATS_ISA_SCALAR;
+#endif
+    kernels.isa = isa;
+    return kernels;
+}
+
+/*
+ Le tabelle dei tre set di istruzioni sono costruite una sola volta e non vengono più modificate. La tabella attiva
+ è indicata da un puntatore atomico: select_statistics_kernels può essere chiamata mentre altri thread stanno
+ calcolando delle statistiche, ed ogni chiamata di un kernel legge il puntatore una sola volta, dunque utilizza
+ una tabella completa, quella precedente o quella nuova.
+*/
+
+static const StatisticsKernels &kernels_for(int isa) {
+    static const StatisticsKernels tables[3] = {
+            make_kernels(STATS_ISA_SCALAR), make_kernels(STATS_ISA_SSE4_1), make_kernels(STATS_ISA_AVX2),
+    };
+    return tables[std::max(STATS_ISA_SCALAR, std::min(isa, (int) STATS_ISA_AVX2))];
+}
+
+static std::atomic<const StatisticsKernels*> &active_kernels() {
+    static std::atomic<const StatisticsKernels*> kernels(&kernels_for(STATS_ISA_AVX2));
+    return kernels;
+}
+
+static const StatisticsKernels &current_kernels() {
+    return *active_kernels().load(std::memory_order_acquire);
+}
+
+// Oltre questa dimensione le somme mobili orizzontali non rientrano in 32 bit
+#define MAX_VECTOR_BLOCK_SIZE 181
+
+void column_sums_update(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums, int width) {
+    current_kernels().sums_update(outgoing, incoming, sums, width);
+}
+
+void column_sums_update(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                        int32_t* squares_sums, int width) {
+    current_kernels().stats_update(outgoing, incoming, sums, squares_sums, width);
+}
+
+void window_row_mean(const int32_t* sums, int block_size, int x_begin, int x_end, unsigned char* mean_row) {
+    if (x_begin >= x_end) return;
+    if (block_size > MAX_VECTOR_BLOCK_SIZE) window_row_mean_scalar(sums, block_size, x_begin, x_end, mean_row);
+    else current_kernels().row_mean(sums, block_size, x_begin, x_end, mean_row);
+}
+
+void window_row_stats(const int32_t* sums, const int32_t* squares_sums, int block_size, int x_begin, int x_end,
+                      unsigned char* mean_row, float* var_row) {
+    if (x_begin >= x_end) return;
+    if (block_size > MAX_VECTOR_BLOCK_SIZE) {
+        window_row_stats_scalar(sums, squares_sums, block_size, x_begin, x_end, mean_row, var_row);
+    }
+    else current_kernels().row_stats(sums, squares_sums, block_size, x_begin, x_end, mean_row, var_row);
+}
+
+int statistics_kernels_isa() {
+    return current_kernels().isa;
+}
+
+void select_statistics_kernels(int isa) {
+    active_kernels().store(&kernels_for(isa), std::memory_order_release);
+}
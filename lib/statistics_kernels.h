@@ -0,0 +1,39 @@
+#ifndef SERVER_APP_STATISTICS_KERNELS_H
+#define SERVER_APP_STATISTICS_KERNELS_H
+
+#include <cstdint>
+
+#define STATS_ISA_SCALAR 0
+#define STATS_ISA_SSE4_1 1
+#define STATS_ISA_AVX2 2
+
+/*
+Questo modulo contiene i cicli interni degli algoritmi a finestra mobile di image_statistics. Ogni kernel esiste in
+una versione scalare ed in versioni vettoriali SSE4.1 ed AVX2; la versione utilizzata viene scelta una sola volta,
+in base alle istruzioni supportate dalla CPU. Tutte le versioni producono esattamente lo stesso risultato.
+
+Le somme lungo le colonne sono mantenute in interi a 32 bit: per una finestra di lato K la somma dei quadrati vale
+al più K x 255^2, dunque a 32 bit rientrano finestre fino a K = 33025. Le somme mobili orizzontali delle versioni
+vettoriali sono anch'esse a 32 bit, e rientrano fino a K = 181: per finestre più grandi viene sempre utilizzata la
+versione scalare, che le mantiene a 64 bit.
+*/
+
+// Aggiorna le somme lungo le colonne sottraendo la riga outgoing ed aggiungendo la riga incoming.
+// Se outgoing è nullo la riga incoming viene solo aggiunta, come durante l'inizializzazione della finestra.
+void column_sums_update(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums, int width);
+void column_sums_update(const unsigned char* outgoing, const unsigned char* incoming, int32_t* sums,
+                        int32_t* squares_sums, int width);
+
+// A partire dalle somme lungo le colonne, calcola media (ed eventualmente varianza) della finestra di lato block_size
+// centrata su ciascuna colonna in [x_begin, x_end). Deve valere x_begin >= block_size/2 ed x_end <= width - block_size/2.
+void window_row_mean(const int32_t* sums, int block_size, int x_begin, int x_end, unsigned char* mean_row);
+void window_row_stats(const int32_t* sums, const int32_t* squares_sums, int block_size, int x_begin, int x_end,
+                      unsigned char* mean_row, float* var_row);
+
+// Restituisce il set di istruzioni utilizzato dai kernel. select_statistics_kernels permette di forzarne uno
+// (ad esempio per confrontare le prestazioni); se la CPU non lo supporta viene scelto il migliore disponibile.
+// La selezione può avvenire in qualunque momento, anche mentre altri thread utilizzano i kernel.
+int statistics_kernels_isa();
+void select_statistics_kernels(int isa);
+
+#endif
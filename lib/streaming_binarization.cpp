@@ -0,0 +1,154 @@
+#include "streaming_binarization.h"
+#include "statistics_kernels.h"
+#include "opencv2/opencv.hpp"
+#include <cstring>
+
+using namespace cv;
+
+/*
+ La prima passata mantiene le somme lungo le colonne sulla maschera BLOCK, ed un buffer circolare con le ultime
+ BLOCK_SIZE righe, da cui vengono lette le righe che escono dalla finestra. Quando la finestra centrata su una riga
+ campionata è completa, viene calcolata la media lungo la riga delle varianze, nella regione che dista almeno
+ CHUNK_SIZE/2 dal bordo, esattamente come fa block_chunk_stats.
+ Se tra due righe fornite c'è un salto, le somme vengono azzerate ed una nuova finestra inizia dalla riga corrente.
+*/
+
+VarianceThresholdEstimator::VarianceThresholdEstimator(const StatisticsBasedBinarization &params, int width,
+                                                       int sampling_step) {
+    if (params.BLOCK_SIZE > params.CHUNK_SIZE) {
+        std::cerr<<"streaming_binarization.VarianceThresholdEstimator(): The block must not be larger than the chunk\n";
+        exit(1);
+    }
+    this->width = width;
+    this->block_size = params.BLOCK_SIZE;
+    this->chunk_size = params.CHUNK_SIZE;
+    this->sampling_step = sampling_step < 1 ? 1 : sampling_step;
+    ring.resize((size_t) block_size * width);
+    rows_sum.resize(width);
+    rows_squares_sum.resize(width);
+    mean_row.resize(width);
+    var_row.resize(width);
+}
+
+bool VarianceThresholdEstimator::needs_row(int row) const {
+    // La finestra centrata sulla k-esima riga campionata copre le righe da first + k x sampling_step a
+    // first + k x sampling_step + BLOCK_SIZE - 1.
+    int first = chunk_size/2 - block_size/2;
+    int distance = row - first;
+    if (distance < 0) return false;
+    return distance % sampling_step < block_size;
+}
+
+void VarianceThresholdEstimator::push_row(int row, const unsigned char* data) {
+    int block_offset = block_size/2, chunk_offset = chunk_size/2;
+    if (row != last_row + 1) {
+        run_start = row;
+        std::fill(rows_sum.begin(), rows_sum.end(), 0);
+        std::fill(rows_squares_sum.begin(), rows_squares_sum.end(), 0);
+    }
+    last_row = row;
+
+    unsigned char* slot = &ring[(size_t) (row % block_size) * width];
+    column_sums_update(row - block_size >= run_start ? slot : nullptr, data, rows_sum.data(), rows_squares_sum.data(), width);
+    memcpy(slot, data, width);
+
+    int center = row - block_offset;
+    if (center < chunk_offset || (center - chunk_offset) % sampling_step) return;
+    if (row - block_size + 1 < run_start || width <= 2*chunk_offset) return;
+
+    int x_begin = chunk_offset, x_end = width - chunk_offset;
+    window_row_stats(rows_sum.data(), rows_squares_sum.data(), block_size, x_begin, x_end, mean_row.data(), var_row.data());
+    float partial_mean = 0;
+    for (int j=x_begin; j<x_end; ++j) {
+        partial_mean += var_row[j];
+    }
+
+    size_t sample = (center - chunk_offset) / sampling_step;
+    if (sample >= row_var_means.size()) row_var_means.resize(sample + 1, 0);
+    row_var_means[sample] = partial_mean / (x_end - x_begin);
+}
+
+float VarianceThresholdEstimator::threshold(int height) const {
+    int chunk_offset = chunk_size/2;
+    float mean = 0;
+    int samples = 0;
+    for (size_t k=0; k<row_var_means.size() && chunk_offset + (int) k*sampling_step < height - chunk_offset; ++k) {
+        mean += row_var_means[k];
+        samples++;
+    }
+    return samples ? mean / samples : 0;
+}
+
+/*
+ La seconda passata mantiene le somme lungo le colonne sulla maschera CHUNK, ed un buffer circolare con le ultime
+ CHUNK_SIZE righe. Quando viene fornita la riga r, la finestra centrata sulla riga r - CHUNK_SIZE/2 è completa: la
+ riga viene binarizzata con lo stesso criterio di StatisticsBasedBinarization ed emessa. Le prime e le ultime
+ CHUNK_SIZE/2 righe, così come le colonne a distanza minore di CHUNK_SIZE/2 dal bordo, sono sempre bianche.
+*/
+
+StreamingBinarization::StreamingBinarization(const StatisticsBasedBinarization &params, int width, float var_th) {
+    this->params = params;
+    this->width = width;
+    this->var_th = var_th;
+    ring.resize((size_t) params.CHUNK_SIZE * width);
+    rows_sum.resize(width);
+    rows_squares_sum.resize(width);
+    mean_row.resize(width);
+    var_row.resize(width);
+    output_row.resize(width);
+}
+
+void StreamingBinarization::push_row(const unsigned char* data, const RowConsumer &emit) {
+    int chunk_size = params.CHUNK_SIZE, offset = chunk_size/2;
+    int row = rows_in++;
+
+    unsigned char* slot = &ring[(size_t) (row % chunk_size) * width];
+    column_sums_update(row >= chunk_size ? slot : nullptr, data, rows_sum.data(), rows_squares_sum.data(), width);
+    memcpy(slot, data, width);
+
+    int output = row - offset;
+    if (output < 0) return;
+    rows_out++;
+    if (output < offset) {
+        std::fill(output_row.begin(), output_row.end(), 255);
+        emit(output_row.data());
+        return;
+    }
+
+    const unsigned char* grey_row = &ring[(size_t) (output % chunk_size) * width];
+    int x_begin = offset, x_end = width - offset;
+    window_row_stats(rows_sum.data(), rows_squares_sum.data(), chunk_size, x_begin, x_end, mean_row.data(), var_row.data());
+    for (int x=0; x<width; ++x) {
+        if (x < x_begin || x >= x_end || var_row[x] < var_th) {
+            output_row[x] = 255;
+        }
+        else {
+            output_row[x] = grey_row[x] > mean_row[x] - params.CORRECTION_OFFSET ? 255 : 0;
+        }
+    }
+    emit(output_row.data());
+}
+
+void StreamingBinarization::finish(const RowConsumer &emit) {
+    std::fill(output_row.begin(), output_row.end(), 255);
+    for (; rows_out < rows_in; ++rows_out) emit(output_row.data());
+}
+
+void stream_binarize_image(int width, int height, const std::function<void(int row, unsigned char* data)> &read_row,
+                           const RowConsumer &emit, const StatisticsBasedBinarization &params, int sampling_step) {
+    std::vector<unsigned char> buffer(width);
+
+    VarianceThresholdEstimator estimator(params, width, sampling_step);
+    for (int row=0; row<height; ++row) {
+        if (!estimator.needs_row(row)) continue;
+        read_row(row, buffer.data());
+        estimator.push_row(row, buffer.data());
+    }
+
+    StreamingBinarization binarization(params, width, estimator.threshold(height));
+    for (int row=0; row<height; ++row) {
+        read_row(row, buffer.data());
+        binarization.push_row(buffer.data(), emit);
+    }
+    binarization.finish(emit);
+}
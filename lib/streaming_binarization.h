@@ -0,0 +1,69 @@
+#ifndef SERVER_APP_STREAMING_BINARIZATION_H
+#define SERVER_APP_STREAMING_BINARIZATION_H
+
+#include "binarization.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ Questo modulo contiene una versione in streaming di StatisticsBasedBinarization, pensata per immagini troppo grandi
+ per essere tenute in memoria insieme alle matrici delle statistiche. Le righe dell'immagine in scala di grigio
+ vengono fornite una alla volta, e le righe binarizzate vengono prodotte non appena disponibili, con un ritardo di
+ CHUNK_SIZE/2 righe. La memoria utilizzata è proporzionale a larghezza x CHUNK_SIZE.
+
+ La soglia var_th dipende dalle varianze di tutta l'immagine, quindi deve essere nota prima che inizi la
+ binarizzazione. VarianceThresholdEstimator la calcola con una prima passata sulle righe: con sampling_step pari ad 1
+ il valore coincide con quello calcolato da StatisticsBasedBinarization, con sampling_step maggiore viene stimato
+ solo sulle righe multiple di sampling_step, e la prima passata legge solo le BLOCK_SIZE righe intorno ad esse.
+*/
+
+typedef std::function<void(const unsigned char* row)> RowConsumer;
+
+class VarianceThresholdEstimator {
+public:
+    explicit VarianceThresholdEstimator(const StatisticsBasedBinarization &params, int width, int sampling_step = 1);
+    // Indica se la riga row è utilizzata per la stima. Le righe per cui restituisce falso possono non essere fornite.
+    bool needs_row(int row) const;
+    // Fornisce la riga row. Le righe devono essere fornite in ordine crescente.
+    void push_row(int row, const unsigned char* data);
+    // Restituisce la soglia per un'immagine di height righe, dopo che tutte le righe necessarie sono state fornite.
+    float threshold(int height) const;
+
+private:
+    int width, block_size, chunk_size, sampling_step;
+    int run_start = -1, last_row = -1;
+    std::vector<unsigned char> ring;
+    std::vector<int32_t> rows_sum, rows_squares_sum;
+    std::vector<unsigned char> mean_row;
+    std::vector<float> var_row;
+    // Media delle varianze lungo la riga, per ciascuna riga campionata
+    std::vector<float> row_var_means;
+};
+
+class StreamingBinarization {
+public:
+    explicit StreamingBinarization(const StatisticsBasedBinarization &params, int width, float var_th);
+    // Fornisce la riga successiva dell'immagine; se una riga binarizzata è pronta viene passata ad emit.
+    void push_row(const unsigned char* data, const RowConsumer &emit);
+    // Da chiamare dopo l'ultima riga: emette le righe rimanenti, che si trovano sul bordo dell'immagine.
+    void finish(const RowConsumer &emit);
+
+private:
+    StatisticsBasedBinarization params;
+    int width;
+    float var_th;
+    int rows_in = 0, rows_out = 0;
+    std::vector<unsigned char> ring;
+    std::vector<int32_t> rows_sum, rows_squares_sum;
+    std::vector<unsigned char> mean_row, output_row;
+    std::vector<float> var_row;
+};
+
+// Binarizza un'immagine in scala di grigio di cui è possibile leggere le righe in qualsiasi ordine, effettuando le
+// due passate descritte sopra.
+void stream_binarize_image(int width, int height, const std::function<void(int row, unsigned char* data)> &read_row,
+                           const RowConsumer &emit, const StatisticsBasedBinarization &params = StatisticsBasedBinarization(),
+                           int sampling_step = 1);
+
+#endif
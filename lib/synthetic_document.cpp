@@ -0,0 +1,175 @@
+#include "synthetic_document.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+
+SyntheticDocument::SyntheticDocument(int width, int height, double rotation, uint64_t seed) {
+    WIDTH = width;
+    HEIGHT = height;
+    ROTATION = rotation;
+    SEED = seed;
+}
+
+/*
+ Il testo è composto da righe di parole, e ciascuna parola da caratteri formati da 2 - 4 tratti scelti tra aste
+ verticali, barre orizzontali e diagonali, con eventuali ascendenti e discendenti. I tratti sono disegnati sulla
+ maschera dell'inchiostro del foglio non ruotato.
+*/
+
+static void draw_text(Mat &ink, RNG &rng) {
+    int page_width = ink.size[1], page_height = ink.size[0];
+    int line_height = std::max(page_height / 45, 6);
+    int x_height = std::max(line_height * 9 / 20, 3);
+    int char_width = std::max(x_height * 4 / 5, 2);
+    int stroke = std::max(line_height / 10, 1);
+    int margin_x = page_width / 12, margin_y = page_height / 14;
+
+    for (int baseline=margin_y + line_height; baseline<page_height - margin_y; baseline += line_height) {
+        // Righe corte alla fine dei paragrafi e qualche riga vuota
+        if (rng.uniform(0, 12) == 0) continue;
+        int line_end = page_width - margin_x - (rng.uniform(0, 5) == 0 ? rng.uniform(0, page_width / 2) : 0);
+        for (int x=margin_x; ; ) {
+            int letters = rng.uniform(1, 10);
+            if (x + letters * char_width > line_end) break;
+            for (int letter=0; letter<letters; ++letter, x += char_width) {
+                int left = x + stroke, right = x + char_width - stroke;
+                int top = baseline - x_height, middle = baseline - x_height / 2;
+                int strokes = rng.uniform(2, 5);
+                for (int k=0; k<strokes; ++k) {
+                    Point from, to;
+                    switch (rng.uniform(0, 6)) {
+                        case 0: from = Point(left, top); to = Point(left, baseline); break;
+                        case 1: from = Point(right, top); to = Point(right, baseline); break;
+                        case 2: from = Point(left, middle); to = Point(right, middle); break;
+                        case 3: from = Point(left, baseline); to = Point(right, top); break;
+                        // Ascendente o discendente
+                        case 4: from = Point(left, baseline - line_height * 7 / 10); to = Point(left, top); break;
+                        default: from = Point(right, baseline); to = Point(right, baseline + line_height / 4); break;
+                    }
+                    line(ink, from, to, Scalar(255), stroke);
+                }
+            }
+            x += char_width;
+        }
+    }
+}
+
+/*
+ La scena viene composta riga per riga: lo sfondo è una trama a bassa frequenza (una griglia casuale ingrandita
+ con interpolazione bicubica) a cui si somma una grana fine; il foglio ruotato viene sovrapposto tramite la sua
+ copertura, calcolata con interpolazione bilineare in modo che i bordi siano sfumati come in una fotografia; infine
+ la luminosità viene modulata da un gradiente lineare in una direzione casuale e viene aggiunto il rumore.
+ Ogni riga utilizza un proprio generatore casuale, inizializzato a partire dal seed e dall'indice della riga, dunque
+ il risultato non dipende dal numero di thread.
+*/
+
+SyntheticScene generate_synthetic_document(const SyntheticDocument &params) {
+    if (params.WIDTH < 16 || params.HEIGHT < 16) {
+        std::cerr<<"synthetic_document.generate_synthetic_document(): The scene must be at least 16 x 16 pixels\n";
+        exit(1);
+    }
+    if (params.ROTATION < -15 || params.ROTATION > 15) {
+        std::cerr<<"synthetic_document.generate_synthetic_document(): The rotation must be between -15 and 15 degrees\n";
+        exit(1);
+    }
+    int width = params.WIDTH, height = params.HEIGHT;
+    RNG rng(params.SEED);
+
+    // Foglio in formato A4 verticale, ridotto finché, ruotato, non è contenuto nell'immagine.
+    double angle = params.ROTATION * CV_PI / 180;
+    double page_height = params.PAGE_SCALE * height, page_width = page_height / 1.414;
+    double rotated_width = page_width * std::cos(angle) + page_height * std::abs(std::sin(angle));
+    double rotated_height = page_width * std::abs(std::sin(angle)) + page_height * std::cos(angle);
+    double fit = std::min(1.0, std::min(0.95 * width / rotated_width, 0.95 * height / rotated_height));
+    int page_cols = std::max((int) (page_width * fit), 8), page_rows = std::max((int) (page_height * fit), 8);
+
+    Mat page_ink(page_rows, page_cols, CV_8U, Scalar(0));
+    draw_text(page_ink, rng);
+
+    // Trasformazione dal foglio alla scena: il foglio è centrato nell'immagine e ruotato attorno al suo centro.
+    Mat transform = getRotationMatrix2D(Point2f(width / 2.f, height / 2.f), params.ROTATION, 1);
+    double offset_x = (width - page_cols) / 2.0, offset_y = (height - page_rows) / 2.0;
+    transform.at<double>(0, 2) += transform.at<double>(0, 0) * offset_x + transform.at<double>(0, 1) * offset_y;
+    transform.at<double>(1, 2) += transform.at<double>(1, 0) * offset_x + transform.at<double>(1, 1) * offset_y;
+
+    SyntheticScene scene;
+    Point2f page_corners[4] = {
+            Point2f(0, 0), Point2f((float) page_cols, 0), Point2f(0, (float) page_rows),
+            Point2f((float) page_cols, (float) page_rows),
+    };
+    float left = (float) width, top = (float) height, right = 0, bottom = 0;
+    for (int corner=0; corner<4; ++corner) {
+        const Point2f &point = page_corners[corner];
+        scene.corners[corner] = Point2f(
+                (float) (transform.at<double>(0, 0) * point.x + transform.at<double>(0, 1) * point.y + transform.at<double>(0, 2)),
+                (float) (transform.at<double>(1, 0) * point.x + transform.at<double>(1, 1) * point.y + transform.at<double>(1, 2)));
+        left = std::min(left, scene.corners[corner].x);
+        top = std::min(top, scene.corners[corner].y);
+        right = std::max(right, scene.corners[corner].x);
+        bottom = std::max(bottom, scene.corners[corner].y);
+    }
+    scene.frame = Rect(Point((int) std::floor(left), (int) std::floor(top)),
+                       Point((int) std::ceil(right), (int) std::ceil(bottom))) & Rect(0, 0, width, height);
+
+    Mat coverage, ink_coverage;
+    warpAffine(Mat(page_rows, page_cols, CV_8U, Scalar(255)), coverage, transform, Size(width, height), INTER_LINEAR,
+               BORDER_CONSTANT, Scalar(0));
+    warpAffine(page_ink, ink_coverage, transform, Size(width, height), INTER_LINEAR, BORDER_CONSTANT, Scalar(0));
+    page_ink.release();
+
+    // Trama dello sfondo
+    Mat texture, grid(std::max(height / 48, 2), std::max(width / 48, 2), CV_8U);
+    rng.fill(grid, RNG::UNIFORM, 0, 256);
+    resize(grid, texture, Size(width, height), 0, 0, INTER_CUBIC);
+
+    // Colori di sfondo, carta ed inchiostro (BGR), ed orientazione del gradiente di luminosità
+    float background[3] = {(float) rng.uniform(50, 90), (float) rng.uniform(70, 110), (float) rng.uniform(90, 140)};
+    float paper[3] = {(float) rng.uniform(225, 240), (float) rng.uniform(228, 242), (float) rng.uniform(230, 245)};
+    float ink[3] = {(float) rng.uniform(20, 50), (float) rng.uniform(20, 50), (float) rng.uniform(20, 60)};
+    double light_angle = rng.uniform(0., 2 * CV_PI);
+    float light_x = (float) std::cos(light_angle), light_y = (float) std::sin(light_angle);
+    float light_range = std::abs(light_x) * width + std::abs(light_y) * height;
+    float light_origin = std::min(0.f, light_x * width) + std::min(0.f, light_y * height);
+
+    scene.image.create(height, width, CV_8UC3);
+    scene.ink_mask.create(height, width, CV_8U);
+    parallel_for_(Range(0, height), [&] (const Range &range) -> void {
+        for (int row=range.start; row<range.end; ++row) {
+            RNG row_rng(params.SEED * 1000003 + (uint64_t) row + 1);
+            const unsigned char* page = coverage.ptr<unsigned char>(row);
+            const unsigned char* inked = ink_coverage.ptr<unsigned char>(row);
+            const unsigned char* grain = texture.ptr<unsigned char>(row);
+            unsigned char* pixels = scene.image.ptr<unsigned char>(row);
+            unsigned char* mask = scene.ink_mask.ptr<unsigned char>(row);
+            for (int col=0; col<width; ++col) {
+                float alpha = page[col] / 255.f, ink_alpha = inked[col] / 255.f;
+                float wood = params.TEXTURE * ((grain[col] - 128) / 128.f + (float) row_rng.uniform(-0.25, 0.25));
+                float gain = 1 - (float) params.LIGHTING * ((light_x * col + light_y * row - light_origin) / light_range);
+                for (int channel=0; channel<3; ++channel) {
+                    float sheet = paper[channel] + (ink[channel] - paper[channel]) * ink_alpha;
+                    float value = (background[channel] + wood) * (1 - alpha) + sheet * alpha;
+                    value = value * gain + (float) row_rng.gaussian(params.NOISE);
+                    pixels[3*col + channel] = saturate_cast<unsigned char>(value);
+                }
+                mask[col] = inked[col] >= 128 ? 255 : 0;
+            }
+        }
+    });
+    return scene;
+}
+
+double intersection_over_union(const Rect &a, const Rect &b) {
+    double intersection = (a & b).area();
+    double union_area = a.area() + b.area() - intersection;
+    return union_area > 0 ? intersection / union_area : 0;
+}
+
+Mat resize_to_megapixels(const Mat &image, double megapixels) {
+    double scale = std::sqrt(megapixels * 1e6 / ((double) image.size[0] * image.size[1]));
+    Size size((int) std::lround(image.size[1] * scale), (int) std::lround(image.size[0] * scale));
+    Mat resized;
+    resize(image, resized, size, 0, 0, scale < 1 ? INTER_AREA : INTER_LINEAR);
+    return resized;
+}
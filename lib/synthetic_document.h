@@ -0,0 +1,61 @@
+#ifndef SERVER_APP_SYNTHETIC_DOCUMENT_H
+#define SERVER_APP_SYNTHETIC_DOCUMENT_H
+
+#include "opencv2/opencv.hpp"
+#include <cstdint>
+using namespace cv;
+
+/*
+ Questo modulo genera scene sintetiche per misurare prestazioni ed accuratezza della pipeline senza utilizzare
+ fotografie reali. Una scena è un foglio chiaro, coperto da righe di tratti scuri simili a testo, appoggiato su uno
+ sfondo con una trama, ruotato di un angolo noto (al più 15° in valore assoluto, come le rette di
+ PageFrame::TANGENT_TABLE), illuminato in modo non uniforme e disturbato da rumore gaussiano.
+ La classe SyntheticDocument contiene esclusivamente dei parametri. A parità di parametri e di seed la scena generata
+ è sempre la stessa.
+ Insieme all'immagine viene restituita la verità di riferimento: i 4 angoli del foglio, il rettangolo minimo che li
+ contiene (ovvero il risultato atteso di get_page_frame) e la maschera dell'inchiostro, che vale 255 sui pixel dei
+ tratti di testo.
+*/
+
+class SyntheticDocument {
+public:
+    int WIDTH = 2000;
+    int HEIGHT = 1500;
+    // Rotazione del foglio in gradi, in senso antiorario, compresa tra -15 e 15
+    double ROTATION = 5;
+    // Lato maggiore del foglio rispetto al lato corrispondente dell'immagine
+    double PAGE_SCALE = 0.75;
+    // Ampiezza della trama dello sfondo, in livelli di grigio
+    int TEXTURE = 40;
+    // Variazione relativa della luminosità tra i due estremi dell'immagine (0 = illuminazione uniforme)
+    double LIGHTING = 0.35;
+    // Deviazione standard del rumore gaussiano, in livelli di grigio
+    double NOISE = 6;
+    uint64_t SEED = 1;
+
+    SyntheticDocument() = default;
+    explicit SyntheticDocument(int width, int height, double rotation, uint64_t seed);
+};
+
+class SyntheticScene {
+public:
+    // Immagine BGR ad 8 bit
+    Mat image;
+    // Maschera dell'inchiostro, CV_8U, nelle coordinate dell'immagine
+    Mat ink_mask;
+    // Angoli del foglio nell'ordine TL_CORNER, TR_CORNER, BL_CORNER, BR_CORNER del foglio non ruotato
+    Point2f corners[4];
+    // Rettangolo minimo che contiene i 4 angoli, limitato all'immagine
+    Rect frame;
+};
+
+SyntheticScene generate_synthetic_document(const SyntheticDocument &params = SyntheticDocument());
+
+// Rapporto tra l'area dell'intersezione e quella dell'unione di due rettangoli, utilizzato per confrontare una
+// cornice trovata con quella di riferimento (0 se entrambi i rettangoli sono vuoti).
+double intersection_over_union(const Rect &a, const Rect &b);
+
+// Ridimensiona l'immagine, mantenendone le proporzioni, in modo che contenga circa megapixels milioni di pixel.
+Mat resize_to_megapixels(const Mat &image, double megapixels);
+
+#endif
@@ -180,10 +180,24 @@ float mmean(float **m, int y_low, int y_high, int x_low, int x_high) {
 }
 
 /*
- The function computes the local mean value of an image
+ The function computes the local mean value of an image. Single precision matrices are averaged with the same
+ accumulation order as mmean(float**, ...), so that the two versions return the same value.
 */
 
 float mmean(Mat m, int y_low, int y_high, int x_low, int x_high) {
+    if (m.depth() == CV_32F) {
+        float partial_float_mean, float_mean = 0;
+        for (int i=y_low; i<y_high; ++i) {
+            auto row = m.ptr<float>(i);
+            partial_float_mean = 0;
+            for (int j=x_low; j<x_high; ++j) {
+                partial_float_mean += row[j];
+            }
+            float_mean += partial_float_mean /= (x_high - x_low);
+        }
+        return float_mean / (y_high - y_low);
+    }
+
     long int partial_mean, mean = 0;
     for (int i=y_low; i<y_high; ++i) {
         partial_mean = 0;
@@ -1,8 +1,6 @@
 #ifndef SERVER_APP_UTILITY_H
 #define SERVER_APP_UTILITY_H
 
-#endif
-
 #include "opencv2/opencv.hpp"
 using namespace cv;
 
@@ -36,3 +34,5 @@ float othsu_threshold(int* histogram, int block_area);
 void rescale_matrix(const Mat& m, float desired_max);
 void rescale_matrix(const Mat& m, float prev_max, float desired_max);
 void histogram_to_file(const Mat& m, const char* path);
+
+#endif
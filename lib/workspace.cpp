@@ -0,0 +1,38 @@
+#include "workspace.h"
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+Workspace::~Workspace() {
+    for (auto &slot : slots) fastFree(slot.data);
+}
+
+/*
+ Quando lo slot non è abbastanza grande viene riallocato con una capacità pari ad almeno una volta e mezza la
+ precedente, in modo che immagini di dimensioni leggermente diverse non causino riallocazioni continue.
+*/
+
+void* Workspace::buffer(int slot, size_t bytes) {
+    if (slot >= (int) slots.size()) slots.resize(slot + 1);
+    Slot &current = slots[slot];
+    if (bytes > current.capacity) {
+        size_t capacity = std::max(bytes, current.capacity + current.capacity/2);
+        capacity = alignSize(capacity, ALIGNMENT);
+        fastFree(current.data);
+        current.data = fastMalloc(capacity);
+        current.capacity = capacity;
+    }
+    return current.data;
+}
+
+Mat Workspace::matrix(int slot, int rows, int cols, int type) {
+    size_t step = alignSize(cols * CV_ELEM_SIZE(type), ALIGNMENT);
+    void* data = buffer(slot, step * rows);
+    return {rows, cols, type, data, step};
+}
+
+size_t Workspace::reserved_bytes() const {
+    size_t total = 0;
+    for (const auto &slot : slots) total += slot.capacity;
+    return total;
+}
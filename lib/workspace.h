@@ -0,0 +1,55 @@
+#ifndef SERVER_APP_WORKSPACE_H
+#define SERVER_APP_WORKSPACE_H
+
+#include "opencv2/opencv.hpp"
+#include <vector>
+
+// Slot dell'arena utilizzati dai vari moduli
+#define WS_GREY_IMAGE 0
+#define WS_BLOCK_MEAN 1
+#define WS_BLOCK_VAR 2
+#define WS_CHUNK_MEAN 3
+#define WS_CHUNK_VAR 4
+#define WS_EDGE_MASK 5
+#define WS_INTEGRAL_SUM 6
+#define WS_INTEGRAL_SQUARES 7
+#define WS_EDGE_BLUR 8
+#define WS_EDGE_GRADIENT 9
+
+using namespace cv;
+
+/*
+ Questo modulo contiene un'arena di memoria che le fasi dell'elaborazione utilizzano per le proprie matrici
+ temporanee. L'arena è suddivisa in slot: ogni slot è un unico blocco contiguo, allineato a 64 byte, che viene
+ riutilizzato tra una chiamata e l'altra ed ingrandito solo quando l'immagine corrente non ci sta.
+ Un thread che elabora più immagini mantiene il proprio Workspace, dunque a regime le matrici temporanee
+ non richiedono alcuna allocazione. Un Workspace non deve essere condiviso tra thread diversi.
+*/
+
+class Workspace {
+public:
+    static const size_t ALIGNMENT = 64;
+
+    Workspace() = default;
+    Workspace(const Workspace &) = delete;
+    Workspace &operator=(const Workspace &) = delete;
+    ~Workspace();
+
+    // Restituisce una matrice rows x cols di tipo type, che punta alla memoria dello slot indicato. Le righe della
+    // matrice iniziano ad indirizzi allineati. Il contenuto non è inizializzato, ed è valido fino alla successiva
+    // richiesta sullo stesso slot.
+    Mat matrix(int slot, int rows, int cols, int type);
+    // Restituisce un buffer di almeno bytes byte, allineato, appartenente allo slot indicato.
+    void* buffer(int slot, size_t bytes);
+    size_t reserved_bytes() const;
+
+private:
+    class Slot {
+    public:
+        void* data = nullptr;
+        size_t capacity = 0;
+    };
+    std::vector<Slot> slots;
+};
+
+#endif
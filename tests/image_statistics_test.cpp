@@ -0,0 +1,53 @@
+#include "../lib/image_statistics.h"
+#include "opencv2/opencv.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace cv;
+
+/*
+ Test dei controlli sui parametri di block_chunk_stats.
+
+ Utilizzo: image_statistics_test
+
+ Le funzioni del modulo terminano il programma quando i parametri non sono validi, dunque ogni chiamata viene
+ eseguita in un processo figlio e ne viene controllato il codice di uscita. Il programma restituisce il numero di
+ verifiche fallite.
+*/
+
+// Esegue block_chunk_stats in un processo figlio e restituisce vero se la chiamata ha terminato il programma.
+static bool rejected(int block_size, int chunk_size) {
+    pid_t child = fork();
+    if (child < 0) {
+        std::cerr<<"image_statistics_test: fork failed\n";
+        exit(1);
+    }
+    if (!child) {
+        Mat image(64, 64, CV_8U, Scalar(128));
+        Mat chunk_mean_matrix(64, 64, CV_8U), chunk_var_matrix(64, 64, CV_32F);
+        freopen("/dev/null", "w", stderr);
+        block_chunk_stats(image, chunk_mean_matrix, chunk_var_matrix, block_size, chunk_size);
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+static int check(bool condition, const char* description) {
+    if (condition) return 0;
+    std::cerr<<"image_statistics_test: "<<description<<"\n";
+    return 1;
+}
+
+int main() {
+    int failures = 0;
+    failures += check(rejected(8, 37), "an even block size is accepted");
+    failures += check(rejected(9, 36), "an even chunk size is accepted");
+    failures += check(rejected(2, 2), "even block and chunk sizes are accepted");
+    failures += check(!rejected(9, 37), "odd block and chunk sizes are rejected");
+    failures += check(!rejected(9, 9), "a block as large as the chunk is rejected");
+    return failures;
+}
@@ -0,0 +1,74 @@
+#include "../lib/lazy_edge_map.h"
+#include "../lib/pre_processing.h"
+#include "../lib/synthetic_document.h"
+#include "opencv2/opencv.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace cv;
+
+/*
+ Test di LazyEdgeMap.
+
+ Utilizzo: lazy_edge_map_test
+
+ Per scene sintetiche le cui dimensioni non sono multipli del lato dei tasselli, a colori ed in scala di grigio e con
+ diverse dimensioni dei filtri, l'immagine ottenuta da materialize deve coincidere pixel per pixel con quella prodotta
+ da pre_process_image sull'intera immagine, bordi compresi. Viene verificato anche il conteggio dei tasselli
+ calcolati. Il programma restituisce il numero di verifiche fallite.
+*/
+
+static int check(bool condition, const std::string &description) {
+    if (condition) return 0;
+    std::cerr<<"lazy_edge_map_test: "<<description<<"\n";
+    return 1;
+}
+
+static int compare(const Mat &input_image, const PreProcessing &params, const std::string &name) {
+    int failures = 0;
+    LazyEdgeMap lazy_image(input_image, params);
+    int tile_side = 1 << LAZY_TILE_SHIFT;
+    int expected_tiles = ((input_image.size[0] + tile_side - 1) / tile_side) *
+                         ((input_image.size[1] + tile_side - 1) / tile_side);
+    failures += check(lazy_image.tile_count() == expected_tiles, name + ": wrong tile count");
+    failures += check(lazy_image.computed_tiles() == 0, name + ": tiles computed before any read");
+
+    lazy_image.at(input_image.size[0] - 1, input_image.size[1] - 1);
+    failures += check(lazy_image.computed_tiles() == 1, name + ": reading one pixel did not compute one tile");
+
+    Mat lazy_filtered = lazy_image.materialize();
+    Mat filtered = pre_process_image(input_image, params);
+    failures += check(lazy_image.computed_tiles() == lazy_image.tile_count(), name + ": materialize left tiles out");
+    failures += check(lazy_filtered.size() == filtered.size() && lazy_filtered.type() == filtered.type(),
+                      name + ": size or type differ from pre_process_image");
+    if (lazy_filtered.size() != filtered.size() || lazy_filtered.type() != filtered.type()) return failures;
+
+    long different = 0;
+    for (int row=0; row<filtered.size[0]; ++row) {
+        const unsigned char* expected = filtered.ptr<unsigned char>(row);
+        const unsigned char* actual = lazy_filtered.ptr<unsigned char>(row);
+        for (int col=0; col<filtered.size[1]; ++col) different += expected[col] != actual[col];
+    }
+    failures += check(!different, name + ": " + std::to_string(different) + " pixels differ from pre_process_image");
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    const int sizes[][2] = {{600, 450}, {257, 300}, {1000, 777}};
+    for (const auto &size : sizes) {
+        SyntheticScene scene = generate_synthetic_document(SyntheticDocument(size[0], size[1], 7, 3));
+        Mat grey_image;
+        cvtColor(scene.image, grey_image, COLOR_BGR2GRAY);
+        std::string name = std::to_string(size[0]) + "x" + std::to_string(size[1]);
+
+        failures += compare(scene.image, PreProcessing(), name + " color");
+        failures += compare(grey_image, PreProcessing(), name + " grey");
+        failures += compare(scene.image, PreProcessing(15, 30, 5), name + " color, small kernels");
+        PreProcessing grayscale_first;
+        grayscale_first.GRAYSCALE_FIRST = true;
+        failures += compare(scene.image, grayscale_first, name + " color, grayscale first");
+    }
+    return failures;
+}
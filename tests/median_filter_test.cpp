@@ -0,0 +1,77 @@
+#include "../lib/median_filter.h"
+#include "opencv2/opencv.hpp"
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace cv;
+
+/*
+ Test di equivalenza di median_filter e medianBlur.
+
+ Utilizzo: median_filter_test
+
+ Per maschere di lato 3, 5 e 51, immagini ad uno e tre canali la cui larghezza non è multipla di MEDIAN_TILE_WIDTH,
+ immagini più piccole della maschera e diverse larghezze dei tasselli, il risultato di median_filter deve coincidere
+ pixel per pixel con quello di medianBlur. Il programma restituisce il numero di verifiche fallite.
+*/
+
+static const Size sizes[] = {Size(300, 200), Size(517, 61), Size(20, 30), Size(1, 9), Size(40, 1)};
+static const int kernel_sizes[] = {3, 5, 51};
+static const int tile_widths[] = {0, 1, 17, 100};
+
+// Immagine casuale in cui metà delle righe usa solo pochi livelli di grigio, così da avere molti valori ripetuti
+static Mat random_image(Size size, int channels, unsigned int seed) {
+    Mat image(size, CV_8UC(channels));
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (int row = 0; row < image.rows; ++row) {
+        unsigned char* data = image.ptr<unsigned char>(row);
+        for (int i = 0; i < image.cols * channels; ++i) {
+            data[i] = (unsigned char) (row % 2 ? value(generator) : value(generator) & 0xC0);
+        }
+    }
+    return image;
+}
+
+static bool same_pixels(const Mat &a, const Mat &b) {
+    if (a.size() != b.size() || a.type() != b.type()) return false;
+    for (int row = 0; row < a.rows; ++row) {
+        if (memcmp(a.ptr<unsigned char>(row), b.ptr<unsigned char>(row), a.cols * a.elemSize())) return false;
+    }
+    return true;
+}
+
+static int check(bool condition, const std::string &description) {
+    if (condition) return 0;
+    std::cerr<<"median_filter_test: "<<description<<"\n";
+    return 1;
+}
+
+int main() {
+    int failures = 0;
+    for (Size size : sizes) {
+        for (int channels : {1, 3}) {
+            Mat image = random_image(size, channels, size.width * 1000 + size.height + channels);
+            for (int kernel_size : kernel_sizes) {
+                Mat expected;
+                medianBlur(image, expected, kernel_size);
+                std::string image_description = std::to_string(size.width) + "x" + std::to_string(size.height) +
+                        " image with " + std::to_string(channels) + " channels, kernel size " +
+                        std::to_string(kernel_size);
+                for (int tile_width : tile_widths) {
+                    Mat filtered;
+                    median_filter(image, filtered, kernel_size, tile_width);
+                    failures += check(same_pixels(filtered, expected), "median_filter differs from medianBlur for " +
+                                      image_description + ", tile width " + std::to_string(tile_width));
+                }
+                Mat in_place = image.clone();
+                median_filter(in_place, in_place, kernel_size);
+                failures += check(same_pixels(in_place, expected),
+                                  "in place median_filter differs from medianBlur for " + image_description);
+            }
+        }
+    }
+    return failures;
+}
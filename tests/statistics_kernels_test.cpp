@@ -0,0 +1,131 @@
+#include "../lib/statistics_kernels.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ Test di equivalenza dei kernel di statistics_kernels.
+
+ Utilizzo: statistics_kernels_test
+
+ Le versioni SSE4.1 ed AVX2 vengono forzate una dopo l'altra con select_statistics_kernels ed i risultati di
+ column_sums_update, window_row_mean e window_row_stats vengono confrontati bit per bit con quelli della versione
+ scalare, facendo scorrere la finestra lungo immagini casuali ed uniformemente bianche di larghezza non multipla di 8
+ e di 16, per finestre di lato 3, 9, 37, 181 (il massimo gestito dalle versioni vettoriali) e 183. Le versioni non
+ supportate dalla CPU vengono saltate. Il programma restituisce il numero di verifiche fallite.
+*/
+
+#define SENTINEL_MEAN 77
+#define SENTINEL_VAR -1.0f
+
+static const int widths[] = {1, 7, 8, 15, 16, 17, 31, 33, 190, 250, 517};
+static const int block_sizes[] = {3, 9, 37, 181, 183};
+
+// Tutto ciò che i kernel producono facendo scorrere una finestra lungo un'immagine
+class KernelTrace {
+public:
+    std::vector<int32_t> sums;
+    std::vector<int32_t> squares_sums;
+    std::vector<unsigned char> means;
+    std::vector<float> vars;
+};
+
+static std::vector<unsigned char> make_image(int width, int height, bool white, unsigned int seed) {
+    std::vector<unsigned char> image((size_t) width * height, 255);
+    if (white) return image;
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> value(0, 255);
+    for (unsigned char &pixel : image) pixel = (unsigned char) value(generator);
+    return image;
+}
+
+static void append_row(std::vector<int32_t> &trace, const std::vector<int32_t> &row) {
+    trace.insert(trace.end(), row.begin(), row.end());
+}
+
+// Calcola le statistiche di ogni riga della finestra di lato block_size, sia sull'intervallo più ampio ammesso sia
+// su un intervallo ridotto che inizia e termina in posizioni non allineate.
+static void window_rows(const std::vector<int32_t> &sums, const std::vector<int32_t> &squares_sums, int block_size,
+                        int width, KernelTrace &trace) {
+    int offset = block_size / 2;
+    if (width - offset <= offset) return;
+    const int ranges[2][2] = {{offset, width - offset}, {offset + 3, width - offset - 5}};
+    for (const int *range : ranges) {
+        std::vector<unsigned char> mean_row(width, SENTINEL_MEAN), stats_mean_row(width, SENTINEL_MEAN);
+        std::vector<float> var_row(width, SENTINEL_VAR);
+        window_row_mean(sums.data(), block_size, range[0], range[1], mean_row.data());
+        window_row_stats(sums.data(), squares_sums.data(), block_size, range[0], range[1], stats_mean_row.data(),
+                         var_row.data());
+        trace.means.insert(trace.means.end(), mean_row.begin(), mean_row.end());
+        trace.means.insert(trace.means.end(), stats_mean_row.begin(), stats_mean_row.end());
+        trace.vars.insert(trace.vars.end(), var_row.begin(), var_row.end());
+    }
+}
+
+// Fa scorrere la finestra lungo l'immagine come image_statistics, con entrambe le versioni di column_sums_update.
+static KernelTrace run_kernels(const std::vector<unsigned char> &image, int width, int height, int block_size) {
+    KernelTrace trace;
+    std::vector<int32_t> sums(width, 0), stats_sums(width, 0), squares_sums(width, 0);
+    for (int row = 0; row < block_size; ++row) {
+        const unsigned char* incoming = image.data() + (size_t) row * width;
+        column_sums_update(nullptr, incoming, sums.data(), width);
+        column_sums_update(nullptr, incoming, stats_sums.data(), squares_sums.data(), width);
+    }
+    for (int row = block_size; ; ++row) {
+        append_row(trace.sums, sums);
+        append_row(trace.sums, stats_sums);
+        append_row(trace.squares_sums, squares_sums);
+        window_rows(stats_sums, squares_sums, block_size, width, trace);
+        if (row == height) break;
+        const unsigned char* outgoing = image.data() + (size_t) (row - block_size) * width;
+        const unsigned char* incoming = image.data() + (size_t) row * width;
+        column_sums_update(outgoing, incoming, sums.data(), width);
+        column_sums_update(outgoing, incoming, stats_sums.data(), squares_sums.data(), width);
+    }
+    return trace;
+}
+
+static bool same_bits(const KernelTrace &a, const KernelTrace &b) {
+    return a.sums == b.sums && a.squares_sums == b.squares_sums && a.means == b.means && a.vars.size() == b.vars.size()
+           && (a.vars.empty() || !memcmp(a.vars.data(), b.vars.data(), a.vars.size() * sizeof(float)));
+}
+
+static int check(bool condition, const std::string &description) {
+    if (condition) return 0;
+    std::cerr<<"statistics_kernels_test: "<<description<<"\n";
+    return 1;
+}
+
+int main() {
+    int failures = 0;
+    const int isas[] = {STATS_ISA_SSE4_1, STATS_ISA_AVX2};
+    const char* isa_names[] = {"scalar", "SSE4.1", "AVX2"};
+    for (int isa : isas) {
+        select_statistics_kernels(isa);
+        if (statistics_kernels_isa() != isa) {
+            std::cerr<<"statistics_kernels_test: "<<isa_names[isa]<<" not supported, skipped\n";
+            continue;
+        }
+        for (int width : widths) {
+            for (int block_size : block_sizes) {
+                for (bool white : {false, true}) {
+                    int height = block_size + 12;
+                    std::vector<unsigned char> image = make_image(width, height, white, width * 1000 + block_size);
+                    select_statistics_kernels(STATS_ISA_SCALAR);
+                    KernelTrace expected = run_kernels(image, width, height, block_size);
+                    select_statistics_kernels(isa);
+                    KernelTrace actual = run_kernels(image, width, height, block_size);
+                    failures += check(same_bits(expected, actual),
+                                      std::string(isa_names[isa]) + " differs from scalar for width " +
+                                      std::to_string(width) + ", block size " + std::to_string(block_size) +
+                                      (white ? ", white image" : ", random image"));
+                }
+            }
+        }
+    }
+    select_statistics_kernels(STATS_ISA_AVX2);
+    return failures;
+}
@@ -0,0 +1,215 @@
+#include "../lib/page_frame.h"
+#include "../lib/run_length_index.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cv;
+
+/*
+ Micro-benchmark di edge_chase.
+
+ Utilizzo: edge_chase_benchmark [-s width height] [-d chase_depth] [-r repetitions] [-n starts]
+
+ Viene generata un'immagine filtrata simile a quelle prodotte dal pre-processing: il contorno bianco di un foglio
+ leggermente ruotato, righe di testo formate da brevi tratti e pixel isolati di rumore. edge_chase viene poi
+ invocata su tutti i pixel bianchi delle aree di ricerca dei 4 angoli, nella direzione usata dalla rispettiva
+ passata, e ne viene misurato il tempo per chiamata confrontandolo con la versione a macchina a stati con
+ puntatori a funzione e line_fit in virgola mobile (riportata qui sotto come riferimento). Il programma verifica
+ anche che le due versioni diano lo stesso esito su ogni pixel.
+ Per la versione con RunLengthIndex viene riportato anche il tempo di costruzione dell'indice, ed il tempo per
+ chiamata che comprende la costruzione ripartita sulle chiamate: get_page_frame costruisce l'indice ad ogni immagine.
+*/
+
+struct ChaseStart {
+    int row, col, direction;
+};
+
+// La versione di edge_chase precedente alla specializzazione per direzione, senza indice. I pixel fuori
+// dall'immagine sono neri, come nella versione attuale.
+static bool reference_edge_chase(const Mat &image, int row, int col, int chase_direction, const PageFrame &params) {
+    void (*next_pixel) (int &row, int &col);
+    void (*line_fit) (double M, int start_row, int start_col, int curr_row, int curr_col, int &projected_row, int &projected_col);
+    switch (chase_direction) {
+        case W_E: next_pixel = next_pixel_W_E; line_fit = line_fit_W_E; break;
+        case E_W: next_pixel = next_pixel_E_W; line_fit = line_fit_E_W; break;
+        case N_S: next_pixel = next_pixel_N_S; line_fit = line_fit_N_S; break;
+        default: next_pixel = next_pixel_S_N; line_fit = line_fit_S_N; break;
+    }
+    if (!image.at<unsigned char>(row, col)) return false;
+
+    int start_row = row, start_col = col;
+    int projected_row, projected_col;
+    next_pixel(row, col);
+    int iterations = 1, adjustments = 0;
+    double M = 0;
+    int next_state = KEEP_CHASING;
+    for (;;) {
+        switch (next_state) {
+            case KEEP_CHASING:
+                next_pixel(row, col);
+                if (!valid_pixel(image, row, col)) return false;
+                if (image.at<unsigned char>(row, col)) {
+                    if (++iterations == params.CHASE_DEPTH) return true;
+                }
+                else if (iterations >= params.CHASE_DEPTH / 2) next_state = ADJUST_ORIENTATION;
+                else return false;
+                break;
+            case ADJUST_ORIENTATION:
+                if (adjustments == std::min(params.MAX_ADJUSTMENTS, TANGENT_TABLE_SIZE)) return false;
+                M = PageFrame::TANGENT_TABLE[adjustments++];
+                row = start_row;
+                col = start_col;
+                iterations = 1;
+                next_state = FIT_LINE;
+                break;
+            default:
+                next_pixel(row, col);
+                line_fit(M, start_row, start_col, row, col, projected_row, projected_col);
+                if (valid_pixel(image, projected_row, projected_col) &&
+                    image.at<unsigned char>(projected_row, projected_col)) {
+                    if (++iterations == params.CHASE_DEPTH) return true;
+                }
+                else next_state = ADJUST_ORIENTATION;
+                break;
+        }
+    }
+}
+
+static void draw_line(Mat &image, double r0, double c0, double r1, double c1, int thickness) {
+    int steps = (int) std::max(std::abs(r1 - r0), std::abs(c1 - c0)) + 1;
+    for (int k=0; k<=steps; ++k) {
+        int r = (int) (r0 + (r1 - r0) * k / steps), c = (int) (c0 + (c1 - c0) * k / steps);
+        for (int i=r-thickness/2; i<=r+thickness/2; ++i) {
+            for (int j=c-thickness/2; j<=c+thickness/2; ++j) {
+                if (i >= 0 && j >= 0 && i < image.size[0] && j < image.size[1]) image.at<unsigned char>(i, j) = 255;
+            }
+        }
+    }
+}
+
+// Un'immagine filtrata tipica: contorno spesso del foglio, ruotato di meno di un grado, righe di testo e rumore.
+static Mat synthetic_edge_map(int width, int height, std::mt19937 &rng) {
+    Mat image(height, width, CV_8U, Scalar(0));
+    double margin_x = width * 0.08, margin_y = height * 0.06, tilt = 0.015;
+    double corners[4][2] = {
+            {margin_y, margin_x}, {margin_y + tilt * width, width - margin_x},
+            {height - margin_y, width - margin_x - tilt * height}, {height - margin_y - tilt * width, margin_x + tilt * height},
+    };
+    for (int k=0; k<4; ++k) {
+        draw_line(image, corners[k][0], corners[k][1], corners[(k+1)%4][0], corners[(k+1)%4][1], 9);
+    }
+    std::uniform_int_distribution<int> stroke(4, 40);
+    for (int line=(int) (margin_y * 2); line<height - margin_y * 2; line += 40) {
+        for (int col=(int) (margin_x * 2); col<width - margin_x * 2; col += stroke(rng) + 10) {
+            int length = stroke(rng);
+            draw_line(image, line, col, line, col + length, 2);
+            if (length % 3 == 0) draw_line(image, line - 12, col, line + 6, col, 2);
+        }
+    }
+    std::uniform_int_distribution<int> row_position(0, height - 1), col_position(0, width - 1);
+    for (long k=0; k<(long) width * height / 500; ++k) image.at<unsigned char>(row_position(rng), col_position(rng)) = 255;
+    return image;
+}
+
+static void usage(const char* program) {
+    std::cerr<<"usage: "<<program<<" [-s width height] [-d chase_depth] [-r repetitions] [-n starts]\n";
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int width = 3000, height = 4000, repetitions = 5;
+    size_t max_starts = 2000000;
+    PageFrame params;
+
+    for (int i=1; i<argc; ++i) {
+        if (!strcmp(argv[i], "-s") && i+2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-d") && i+1 < argc) params.CHASE_DEPTH = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i+1 < argc) repetitions = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i+1 < argc) max_starts = (size_t) atol(argv[++i]);
+        else usage(argv[0]);
+    }
+    if (width < 16 || height < 16 || repetitions < 1 || params.CHASE_DEPTH < 1) usage(argv[0]);
+
+    std::mt19937 rng(1);
+    Mat image = synthetic_edge_map(width, height, rng);
+
+    // I pixel di partenza: i pixel bianchi delle aree di ricerca, con la direzione delle passate per riga e per colonna.
+    std::vector<ChaseStart> starts;
+    for (int corner=TL_CORNER; corner<=BR_CORNER && starts.size() < max_starts; ++corner) {
+        Rect area = corner_search_area(image, corner);
+        bool top = corner == TL_CORNER || corner == TR_CORNER;
+        bool left = corner == TL_CORNER || corner == BL_CORNER;
+        for (int row=area.y; row<area.y + area.height && starts.size() < max_starts; ++row) {
+            for (int col=area.x; col<area.x + area.width; ++col) {
+                if (!image.at<unsigned char>(row, col)) continue;
+                starts.push_back({row, col, top ? N_S : S_N});
+                starts.push_back({row, col, left ? W_E : E_W});
+            }
+        }
+    }
+    if (starts.empty()) {
+        std::cerr<<"edge_chase_benchmark: the edge map has no white pixels\n";
+        return 1;
+    }
+
+    long mismatches = 0, accepted = 0;
+    for (const ChaseStart &start : starts) {
+        bool expected = reference_edge_chase(image, start.row, start.col, start.direction, params);
+        bool actual = edge_chase(image, start.row, start.col, start.direction, params);
+        mismatches += expected != actual;
+        accepted += actual;
+    }
+
+    // La costruzione dell'indice viene ripetuta ad ogni ricerca degli angoli, dunque il suo costo va sommato a quello
+    // delle chiamate che accelera.
+    long checksum = 0;
+    double build_nanoseconds = 0;
+    for (int repetition=0; repetition<repetitions; ++repetition) {
+        auto begin = std::chrono::steady_clock::now();
+        RunLengthIndex built(image);
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        checksum += built.run_length(0, 0, W_E);
+        if (!repetition || elapsed < build_nanoseconds) build_nanoseconds = elapsed;
+    }
+    RunLengthIndex index(image);
+    const char* names[3] = {"reference", "specialized", "specialized+index"};
+    double nanoseconds[3];
+    for (int version=0; version<3; ++version) {
+        double best = 0;
+        for (int repetition=0; repetition<repetitions; ++repetition) {
+            auto begin = std::chrono::steady_clock::now();
+            for (const ChaseStart &start : starts) {
+                if (version == 0) checksum += reference_edge_chase(image, start.row, start.col, start.direction, params);
+                else if (version == 1) checksum += edge_chase(image, start.row, start.col, start.direction, params);
+                else checksum += edge_chase(image, start.row, start.col, start.direction, params, &index);
+            }
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+            if (!repetition || elapsed < best) best = elapsed;
+        }
+        nanoseconds[version] = best / starts.size();
+    }
+
+    printf("image %dx%d, chase depth %d, %zu calls, %ld accepted, checksum %ld\n", width, height, params.CHASE_DEPTH,
+           starts.size(), accepted, checksum);
+    for (int version=0; version<3; ++version) {
+        printf("%-18s %8.1f ns/call  speedup %.2fx\n", names[version], nanoseconds[version],
+               nanoseconds[0] / nanoseconds[version]);
+    }
+    double amortized = nanoseconds[2] + build_nanoseconds / starts.size();
+    printf("index build %.2f ms, specialized+index including build %.1f ns/call  speedup %.2fx\n",
+           build_nanoseconds / 1e6, amortized, nanoseconds[0] / amortized);
+    if (mismatches) {
+        std::cerr<<"edge_chase_benchmark: "<<mismatches<<" calls differ from the reference version\n";
+        return 2;
+    }
+    return 0;
+}
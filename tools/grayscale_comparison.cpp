@@ -0,0 +1,171 @@
+#include "../lib/batch.h"
+#include "../lib/packed_edge_map.h"
+#include "../lib/pipeline.h"
+#include "../lib/synthetic_document.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+/*
+ Confronto tra il pre-processing a colori e quello con PreProcessing::GRAYSCALE_FIRST.
+
+ Utilizzo: grayscale_comparison [-n scenes] [-m megapixel] [-r repetitions] [-f text|csv] [-i directory | manifest]
+
+ Per ogni immagine, ovvero n scene sintetiche (default 10) con rotazioni distribuite tra -15° e 15° e, con -i, le
+ immagini reali di una cartella o di un manifest (come per batch_scan), il pre-processing viene eseguito sia sui tre
+ canali sia sull'immagine convertita in grigio. Vengono riportati i tempi (mediana delle ripetizioni), la frazione di
+ pixel uguali tra le due immagini filtrate, l'intersezione su unione tra le due cornici trovate e, per le scene
+ sintetiche, l'intersezione su unione di ciascuna cornice con quella attesa.
+ La binarizzazione non viene confrontata: converte comunque l'immagine in grigio, dunque a parità di cornice il
+ risultato è lo stesso.
+ Le immagini reali sono ridimensionate ad m megapixel (default 12) mantenendone le proporzioni.
+*/
+
+class Comparison {
+public:
+    std::string source;
+    int width = 0, height = 0;
+    double color_ms = 0, gray_ms = 0;
+    double edge_agreement = 0;
+    double frame_agreement = 0;
+    // Accuratezza rispetto alla verità di riferimento, NAN per le immagini reali
+    double color_accuracy = NAN, gray_accuracy = NAN;
+};
+
+static void usage(const char* program) {
+    std::cerr<<"usage: "<<program<<" [-n scenes] [-m megapixel] [-r repetitions] [-f text|csv]"
+               " [-i directory | manifest]\n";
+    exit(1);
+}
+
+// Esegue repetitions volte il pre-processing e restituisce la mediana dei tempi in millisecondi.
+static double timed_pre_processing(const Mat &input_image, const PreProcessing &params, int repetitions,
+                                   Mat &pre_processed_image) {
+    using clock = std::chrono::steady_clock;
+    std::vector<double> times;
+    for (int repetition=0; repetition<repetitions; ++repetition) {
+        auto begin = clock::now();
+        pre_processed_image = pre_process_image(input_image, params);
+        times.push_back(std::chrono::duration<double, std::milli>(clock::now() - begin).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+static Comparison compare(const std::string &source, const Mat &input_image, const SyntheticScene *truth,
+                          int repetitions) {
+    ProcessingConfig config;
+    PreProcessing gray_params = config.pre_processing;
+    gray_params.GRAYSCALE_FIRST = true;
+
+    Comparison comparison;
+    comparison.source = source;
+    comparison.width = input_image.size[1];
+    comparison.height = input_image.size[0];
+
+    Mat color_filtered, gray_filtered;
+    comparison.color_ms = timed_pre_processing(input_image, config.pre_processing, repetitions, color_filtered);
+    comparison.gray_ms = timed_pre_processing(input_image, gray_params, repetitions, gray_filtered);
+    long total = (long) input_image.size[0] * input_image.size[1];
+    long equal = total - countNonZero(color_filtered != gray_filtered);
+    comparison.edge_agreement = (double) equal / total;
+
+    Rect color_frame = get_page_frame(PackedEdgeMap(color_filtered), config.page_frame);
+    Rect gray_frame = get_page_frame(PackedEdgeMap(gray_filtered), config.page_frame);
+    comparison.frame_agreement = intersection_over_union(color_frame, gray_frame);
+    if (truth) {
+        comparison.color_accuracy = intersection_over_union(color_frame, truth->frame);
+        comparison.gray_accuracy = intersection_over_union(gray_frame, truth->frame);
+    }
+    return comparison;
+}
+
+static void print_csv(FILE* stream, const std::vector<Comparison> &comparisons) {
+    fprintf(stream, "source,width,height,color_ms,gray_ms,speedup,edge_agreement,frame_agreement,color_accuracy,"
+                    "gray_accuracy\n");
+    for (const Comparison &c : comparisons) {
+        fprintf(stream, "%s,%d,%d,%.3f,%.3f,%.3f,%.5f,%.5f,", c.source.c_str(), c.width, c.height, c.color_ms,
+                c.gray_ms, c.color_ms / c.gray_ms, c.edge_agreement, c.frame_agreement);
+        if (!std::isnan(c.color_accuracy)) fprintf(stream, "%.5f,%.5f", c.color_accuracy, c.gray_accuracy);
+        else fprintf(stream, ",");
+        fprintf(stream, "\n");
+    }
+}
+
+static void print_text(FILE* stream, const std::vector<Comparison> &comparisons) {
+    fprintf(stream, "%-32s %10s %10s %8s %10s %10s %10s %10s\n", "source", "color_ms", "gray_ms", "speedup",
+            "edge_agr", "frame_iou", "color_acc", "gray_acc");
+    double speedup = 0, frame_agreement = 0, worst_agreement = 1;
+    double color_accuracy = 0, gray_accuracy = 0;
+    int scenes = 0;
+    for (const Comparison &c : comparisons) {
+        fprintf(stream, "%-32s %10.2f %10.2f %8.2f %10.5f %10.5f", c.source.c_str(), c.color_ms, c.gray_ms,
+                c.color_ms / c.gray_ms, c.edge_agreement, c.frame_agreement);
+        if (!std::isnan(c.color_accuracy)) {
+            fprintf(stream, " %10.5f %10.5f", c.color_accuracy, c.gray_accuracy);
+            color_accuracy += c.color_accuracy;
+            gray_accuracy += c.gray_accuracy;
+            ++scenes;
+        }
+        fprintf(stream, "\n");
+        speedup += c.color_ms / c.gray_ms;
+        frame_agreement += c.frame_agreement;
+        worst_agreement = std::min(worst_agreement, c.frame_agreement);
+    }
+    if (comparisons.empty()) return;
+    fprintf(stream, "\nmean speedup %.2f, mean frame agreement %.5f, worst frame agreement %.5f\n",
+            speedup / comparisons.size(), frame_agreement / comparisons.size(), worst_agreement);
+    if (scenes) {
+        fprintf(stream, "synthetic scenes: mean accuracy %.5f (color) vs %.5f (gray)\n", color_accuracy / scenes,
+                gray_accuracy / scenes);
+    }
+}
+
+int main(int argc, char** argv) {
+    int scenes = 10, repetitions = 3;
+    double megapixels = 12;
+    std::string format = "text";
+    const char* source = nullptr;
+
+    for (int i=1; i<argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i+1 < argc) scenes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i+1 < argc) megapixels = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i+1 < argc) repetitions = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f") && i+1 < argc) format = argv[++i];
+        else if (!strcmp(argv[i], "-i") && i+1 < argc) source = argv[++i];
+        else usage(argv[0]);
+    }
+    if (scenes < 0 || megapixels <= 0 || repetitions < 1 || (format != "text" && format != "csv")) usage(argv[0]);
+
+    std::vector<Comparison> comparisons;
+    int width = (int) std::lround(std::sqrt(megapixels * 1e6 * 4 / 3));
+    for (int scene_index=0; scene_index<scenes; ++scene_index) {
+        double rotation = scenes > 1 ? -15 + 30.0 * scene_index / (scenes - 1) : 0;
+        SyntheticScene scene = generate_synthetic_document(SyntheticDocument(width, width * 3 / 4, rotation,
+                                                                             scene_index + 1));
+        std::string name = "synthetic_" + std::to_string(scene_index);
+        comparisons.push_back(compare(name, scene.image, &scene, repetitions));
+    }
+    if (source) {
+        for (const std::string &path : collect_batch_inputs(source)) {
+            Mat image = imread(path, IMREAD_COLOR);
+            if (image.empty()) {
+                std::cerr<<"grayscale_comparison: cannot read "<<path<<"\n";
+                continue;
+            }
+            comparisons.push_back(compare(path, resize_to_megapixels(image, megapixels), nullptr, repetitions));
+        }
+    }
+
+    if (format == "csv") print_csv(stdout, comparisons);
+    else print_text(stdout, comparisons);
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "../lib/image_statistics.h"
+#include "../lib/median_filter.h"
+#include "../lib/packed_edge_map.h"
+#include "../lib/perf_counters.h"
+#include "../lib/pipeline.h"
+#include "../lib/synthetic_document.h"
+#include "opencv2/opencv.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+/*
+ Profilazione dei kernel principali tramite i contatori hardware della CPU (vedi perf_counters.h).
+
+ Utilizzo: perf_profile [-i image] [-m megapixel] [-r repetitions] [-t opencv_threads] [-f text|csv]
+
+ Sull'immagine indicata, o su una scena sintetica di 12 megapixel, vengono eseguiti uno alla volta: il filtro mediano
+ del pre-processing, l'edge detection, le passate per riga e per colonna della ricerca degli angoli (senza
+ RunLengthIndex, in modo da misurare la scansione dell'immagine filtrata ad 8 bit), get_page_frame sull'immagine
+ compressa e block_stats della binarizzazione basata su statistiche. Per ciascuno vengono riportati cicli, istruzioni,
+ IPC, cache miss e branch miss per esecuzione e per megapixel.
+ Per default OpenCV utilizza un solo thread, in modo che i contatori, aperti sul thread principale, coprano tutto il
+ lavoro; con -t i thread di OpenCV creati dopo l'apertura dei contatori vengono comunque contati.
+*/
+
+class KernelProfile {
+public:
+    std::string name;
+    double megapixels = 0;
+    int repetitions = 0;
+    PerfSample total;
+};
+
+static void usage(const char* program) {
+    std::cerr<<"usage: "<<program<<" [-i image] [-m megapixel] [-r repetitions] [-t opencv_threads] [-f text|csv]\n";
+    exit(1);
+}
+
+static double per_run(const KernelProfile &profile, int event) {
+    return (double) profile.total.values[event] / profile.repetitions;
+}
+
+static void print_text(FILE* stream, const std::vector<KernelProfile> &profiles) {
+    fprintf(stream, "%-22s %10s %14s %14s %6s %12s %12s %12s %12s\n", "kernel", "ms", "cycles", "instructions", "IPC",
+            "cache_misses", "branch_miss", "cycles/MP", "c.miss/MP");
+    for (const KernelProfile &profile : profiles) {
+        double cycles = per_run(profile, PERF_CYCLES), instructions = per_run(profile, PERF_INSTRUCTIONS);
+        fprintf(stream, "%-22s %10.2f %14.0f %14.0f %6.2f %12.0f %12.0f %12.0f %12.0f\n", profile.name.c_str(),
+                profile.total.wall_ms / profile.repetitions, cycles, instructions, cycles > 0 ? instructions / cycles : 0,
+                per_run(profile, PERF_CACHE_MISSES), per_run(profile, PERF_BRANCH_MISSES), cycles / profile.megapixels,
+                per_run(profile, PERF_CACHE_MISSES) / profile.megapixels);
+    }
+}
+
+static void print_csv(FILE* stream, const std::vector<KernelProfile> &profiles) {
+    fprintf(stream, "kernel,megapixels,repetitions,ms");
+    for (int event=0; event<PERF_EVENT_COUNT; ++event) {
+        fprintf(stream, ",%s,%s_per_megapixel", PerfCounters::event_name(event), PerfCounters::event_name(event));
+    }
+    fprintf(stream, "\n");
+    for (const KernelProfile &profile : profiles) {
+        fprintf(stream, "%s,%.2f,%d,%.3f", profile.name.c_str(), profile.megapixels, profile.repetitions,
+                profile.total.wall_ms / profile.repetitions);
+        for (int event=0; event<PERF_EVENT_COUNT; ++event) {
+            if (!profile.total.valid[event]) fprintf(stream, ",,");
+            else fprintf(stream, ",%.0f,%.0f", per_run(profile, event), per_run(profile, event) / profile.megapixels);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* image_path = nullptr;
+    double megapixels = 12;
+    int repetitions = 3, threads = 1;
+    std::string format = "text";
+
+    for (int i=1; i<argc; ++i) {
+        if (!strcmp(argv[i], "-i") && i+1 < argc) image_path = argv[++i];
+        else if (!strcmp(argv[i], "-m") && i+1 < argc) megapixels = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i+1 < argc) repetitions = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i+1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f") && i+1 < argc) format = argv[++i];
+        else usage(argv[0]);
+    }
+    if (megapixels <= 0 || repetitions < 1 || threads < 1 || (format != "text" && format != "csv")) usage(argv[0]);
+
+    // I contatori vengono aperti prima che OpenCV crei i propri thread, in modo che li ereditino.
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cerr<<"perf_profile: hardware counters are not available: "<<counters.error()<<"\n";
+        return 1;
+    }
+    setNumThreads(threads);
+
+    Mat input_image;
+    if (image_path) {
+        input_image = imread(image_path, IMREAD_COLOR);
+        if (input_image.empty()) {
+            std::cerr<<"perf_profile: cannot read "<<image_path<<"\n";
+            return 1;
+        }
+    }
+    else {
+        int width = (int) std::lround(std::sqrt(megapixels * 1e6 * 4 / 3));
+        input_image = generate_synthetic_document(SyntheticDocument(width, width * 3 / 4, 5, 1)).image;
+    }
+    double image_megapixels = (double) input_image.size[0] * input_image.size[1] / 1e6;
+
+    ProcessingConfig config;
+    PageFrame scan_params = config.page_frame;
+    scan_params.RUN_LENGTH_INDEX = false;
+    Mat median_image, filtered_image, grey_image, mean_matrix, var_matrix;
+    median_filter(input_image, median_image, config.pre_processing.BLUR_KERNEL_SIZE);
+    filtered_image = edge_detection(median_image, config.pre_processing);
+    PackedEdgeMap packed_image(filtered_image);
+    cvtColor(input_image, grey_image, COLOR_BGR2GRAY);
+    // block_stats scrive nelle matrici senza allocarle.
+    mean_matrix = Mat(grey_image.size(), CV_8U);
+    var_matrix = Mat(grey_image.size(), CV_32F);
+    Rect search_areas[4];
+    for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+        search_areas[corner] = corner_search_area(filtered_image, corner);
+    }
+
+    auto corner_passes = [&] (bool rows_first) {
+        for (int corner=TL_CORNER; corner<=BR_CORNER; ++corner) {
+            corner_search_pass(filtered_image, corner, rows_first, search_areas[corner], scan_params);
+        }
+    };
+    std::vector<std::pair<std::string, std::function<void ()>>> kernels = {
+            {"median_blur", [&] () { median_filter(input_image, median_image, config.pre_processing.BLUR_KERNEL_SIZE); }},
+            {"edge_detection", [&] () { filtered_image = edge_detection(median_image, config.pre_processing); }},
+            {"corner_search_rows", [&] () { corner_passes(true); }},
+            {"corner_search_columns", [&] () { corner_passes(false); }},
+            {"get_page_frame_packed", [&] () { get_page_frame(packed_image, config.page_frame); }},
+            {"block_stats", [&] () { block_stats(grey_image, mean_matrix, var_matrix, config.binarization.BLOCK_SIZE); }},
+    };
+
+    std::vector<KernelProfile> profiles;
+    for (auto &kernel : kernels) {
+        KernelProfile profile;
+        profile.name = kernel.first;
+        profile.megapixels = image_megapixels;
+        profile.repetitions = repetitions;
+        for (int repetition=0; repetition<repetitions; ++repetition) {
+            counters.start();
+            kernel.second();
+            profile.total += counters.stop();
+        }
+        profiles.push_back(profile);
+    }
+
+    if (format == "csv") print_csv(stdout, profiles);
+    else print_text(stdout, profiles);
+    return 0;
+}
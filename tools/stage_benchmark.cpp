@@ -0,0 +1,324 @@
+#include "../lib/batch.h"
+#include "../lib/lazy_edge_map.h"
+#include "../lib/packed_edge_map.h"
+#include "../lib/pipeline.h"
+#include "../lib/pipeline_trace.h"
+#include "../lib/synthetic_document.h"
+#include "opencv2/opencv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cv;
+
+/*
+ Benchmark delle singole fasi della pipeline di elaborazione.
+
+ Utilizzo: stage_benchmark [-m megapixel,...] [-t threads,...] [-b statistics,filtering] [-r repetitions]
+                           [-f csv|json] [-o output_file] [--rotation degrees] [-i directory | manifest]
+
+ Per ogni immagine, ogni risoluzione (in megapixel, default 2, 8, 12, 24 e 48), ogni numero di thread di OpenCV ed
+ ogni binarizzazione vengono misurati separatamente il pre-processing, la ricerca della cornice (compresa la
+ compressione dell'immagine filtrata, se abilitata), la binarizzazione del ritaglio della pagina e la pipeline
+ completa. La fase lazy_page_frame misura la ricerca della cornice su un LazyEdgeMap, compreso il pre-processing dei
+ soli tasselli letti: va confrontata con la somma di pre_processing e page_frame, ed il suo hash deve coincidere con
+ quello di page_frame. Per questa fase viene riportata anche la frazione dei tasselli calcolati (computed_tiles),
+ ovvero la parte del pre-processing completo effettivamente eseguita. Per la binarizzazione basata su statistiche la
+ pipeline completa è execute_processing_pipeline; per quella basata su filtri le stesse fasi sono eseguite una dopo
+ l'altra.
+ Le immagini sono una scena sintetica (vedi synthetic_document.h) generata alla risoluzione richiesta e, con -i, le
+ immagini reali di una cartella o di un manifest (come per batch_scan), ridimensionate ad ogni risoluzione
+ mantenendone le proporzioni.
+ Ogni misura è ripetuta più volte e vengono riportati la mediana ed il minimo, in millisecondi, anche per megapixel.
+ Per ogni fase viene inoltre riportato un hash del risultato (il rettangolo trovato o i pixel binarizzati), che
+ permette di verificare se un'ottimizzazione ha cambiato i risultati, e per la scena sintetica l'accuratezza rispetto
+ alla verità di riferimento: l'intersezione su unione tra il rettangolo trovato e quello atteso per la ricerca della
+ cornice, e la F-measure dei pixel di inchiostro per la binarizzazione.
+*/
+
+class StageResult {
+public:
+    std::string source, binarizer, stage;
+    int width = 0, height = 0, threads = 0, repetitions = 0;
+    double median_ms = 0, min_ms = 0;
+    // NAN se non è disponibile la verità di riferimento
+    double accuracy = NAN;
+    uint64_t result_hash = 0;
+    // Frazione dei tasselli del LazyEdgeMap calcolati dalla ricerca, NAN per le altre fasi
+    double computed_tiles = NAN;
+
+    double megapixels() const { return (double) width * height / 1e6; }
+};
+
+static std::vector<double> parse_list(const char* text) {
+    std::vector<double> values;
+    for (const char* position=text; *position; ) {
+        char* end;
+        values.push_back(strtod(position, &end));
+        if (end == position) return {};
+        position = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+static std::vector<std::string> parse_names(const char* text) {
+    std::vector<std::string> names;
+    std::string current;
+    for (const char* position=text; ; ++position) {
+        if (*position == ',' || !*position) {
+            if (!current.empty()) names.push_back(current);
+            current.clear();
+            if (!*position) return names;
+        }
+        else current += *position;
+    }
+}
+
+// FNV-1a a 64 bit
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i=0; i<size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static uint64_t hash_frame(const Rect &frame) {
+    int values[4] = {frame.x, frame.y, frame.width, frame.height};
+    return hash_bytes(14695981039346656037ULL, values, sizeof(values));
+}
+
+static uint64_t hash_image(const Mat &image) {
+    uint64_t hash = hash_bytes(14695981039346656037ULL, image.size.p, 2 * sizeof(int));
+    for (int row=0; row<image.size[0]; ++row) {
+        hash = hash_bytes(hash, image.ptr(row), (size_t) image.size[1] * image.elemSize());
+    }
+    return hash;
+}
+
+// F-measure dei pixel di inchiostro (neri nell'immagine binarizzata) rispetto alla maschera dell'inchiostro. I pixel
+// di inchiostro della scena fuori dal rettangolo trovato contano come non rilevati.
+static double ink_accuracy(const Mat &binarized_image, const Rect &frame, const SyntheticScene &truth) {
+    long true_positives = 0, detected = 0;
+    long expected = countNonZero(truth.ink_mask);
+    for (int row=0; row<binarized_image.size[0]; ++row) {
+        const unsigned char* pixels = binarized_image.ptr<unsigned char>(row);
+        const unsigned char* ink = truth.ink_mask.ptr<unsigned char>(row + frame.y) + frame.x;
+        for (int col=0; col<binarized_image.size[1]; ++col) {
+            bool black = !pixels[col];
+            detected += black;
+            true_positives += black && ink[col];
+        }
+    }
+    if (!detected || !expected) return 0;
+    double precision = (double) true_positives / detected, recall = (double) true_positives / expected;
+    return precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0;
+}
+
+// Misura repetitions esecuzioni di task e ne restituisce la mediana ed il minimo in millisecondi.
+template <class Task>
+static void measure(int repetitions, StageResult &result, Task task) {
+    using clock = std::chrono::steady_clock;
+    std::vector<double> times;
+    for (int repetition=0; repetition<repetitions; ++repetition) {
+        auto begin = clock::now();
+        task();
+        times.push_back(std::chrono::duration<double, std::milli>(clock::now() - begin).count());
+    }
+    std::sort(times.begin(), times.end());
+    result.repetitions = repetitions;
+    result.min_ms = times.front();
+    result.median_ms = times[times.size() / 2];
+}
+
+static Rect find_page_frame(const Mat &pre_processed_image, const PageFrame &params) {
+    if (!params.PACKED_EDGE_MAP) return get_page_frame(pre_processed_image, params);
+    PackedEdgeMap packed_image(pre_processed_image);
+    return get_page_frame(packed_image, params);
+}
+
+static void benchmark_image(const std::string &source, const Mat &input_image, const SyntheticScene *truth,
+                            const std::vector<double> &threads, const std::vector<std::string> &binarizers,
+                            int repetitions, std::vector<StageResult> &results) {
+    ProcessingConfig config;
+    FilteringBasedBinarization filtering;
+    Workspace workspace;
+
+    for (double thread_count : threads) {
+        setNumThreads((int) thread_count);
+        StageResult base;
+        base.source = source;
+        base.width = input_image.size[1];
+        base.height = input_image.size[0];
+        base.threads = (int) thread_count;
+
+        Mat pre_processed_image;
+        StageResult pre_processing = base;
+        pre_processing.binarizer = "-";
+        pre_processing.stage = "pre_processing";
+        measure(repetitions, pre_processing, [&] () {
+            pre_processed_image = pre_process_image(input_image, config.pre_processing);
+        });
+        pre_processing.result_hash = hash_image(pre_processed_image);
+        results.push_back(pre_processing);
+
+        Rect page_frame;
+        StageResult corner_search = base;
+        corner_search.binarizer = "-";
+        corner_search.stage = "page_frame";
+        measure(repetitions, corner_search, [&] () {
+            page_frame = find_page_frame(pre_processed_image, config.page_frame);
+        });
+        corner_search.result_hash = hash_frame(page_frame);
+        if (truth) corner_search.accuracy = intersection_over_union(page_frame, truth->frame);
+        results.push_back(corner_search);
+
+        Rect lazy_frame;
+        double computed_tiles = 0;
+        StageResult lazy_search = base;
+        lazy_search.binarizer = "-";
+        lazy_search.stage = "lazy_page_frame";
+        measure(repetitions, lazy_search, [&] () {
+            LazyEdgeMap lazy_image(input_image, config.pre_processing);
+            lazy_frame = get_page_frame(lazy_image, config.page_frame);
+            computed_tiles = (double) lazy_image.computed_tiles() / lazy_image.tile_count();
+        });
+        lazy_search.computed_tiles = computed_tiles;
+        lazy_search.result_hash = hash_frame(lazy_frame);
+        if (truth) lazy_search.accuracy = intersection_over_union(lazy_frame, truth->frame);
+        results.push_back(lazy_search);
+        Mat page = input_image(page_frame);
+
+        for (const std::string &binarizer : binarizers) {
+            bool statistics = binarizer == "statistics";
+            Mat binarized_image;
+            StageResult binarization = base;
+            binarization.binarizer = binarizer;
+            binarization.stage = "binarization";
+            measure(repetitions, binarization, [&] () {
+                if (statistics) config.binarization.binarize_image(page, binarized_image, workspace);
+                else filtering.binarize_image(page, binarized_image, workspace, config.pre_processing);
+            });
+            binarization.result_hash = hash_image(binarized_image);
+            if (truth) binarization.accuracy = ink_accuracy(binarized_image, page_frame, *truth);
+            results.push_back(binarization);
+
+            StageResult pipeline = base;
+            pipeline.binarizer = binarizer;
+            pipeline.stage = "pipeline";
+            measure(repetitions, pipeline, [&] () {
+                if (statistics) {
+                    binarized_image = execute_processing_pipeline(input_image, config, workspace);
+                    return;
+                }
+                Rect frame = find_page_frame(pre_process_image(input_image, config.pre_processing), config.page_frame);
+                filtering.binarize_image(input_image(frame), binarized_image, workspace, config.pre_processing);
+            });
+            pipeline.result_hash = hash_image(binarized_image);
+            if (truth) pipeline.accuracy = ink_accuracy(binarized_image, page_frame, *truth);
+            results.push_back(pipeline);
+        }
+    }
+}
+
+static void write_csv(FILE* stream, const std::vector<StageResult> &results) {
+    fprintf(stream, "source,width,height,megapixels,threads,binarizer,stage,repetitions,median_ms,min_ms,ms_per_megapixel,"
+                    "accuracy,result_hash,computed_tiles\n");
+    for (const StageResult &result : results) {
+        fprintf(stream, "%s,%d,%d,%.2f,%d,%s,%s,%d,%.3f,%.3f,%.3f,", result.source.c_str(), result.width,
+                result.height, result.megapixels(), result.threads, result.binarizer.c_str(), result.stage.c_str(),
+                result.repetitions, result.median_ms, result.min_ms, result.median_ms / result.megapixels());
+        if (!std::isnan(result.accuracy)) fprintf(stream, "%.5f", result.accuracy);
+        fprintf(stream, ",%016llx,", (unsigned long long) result.result_hash);
+        if (!std::isnan(result.computed_tiles)) fprintf(stream, "%.5f", result.computed_tiles);
+        fprintf(stream, "\n");
+    }
+}
+
+static void write_json(FILE* stream, const std::vector<StageResult> &results) {
+    fprintf(stream, "[\n");
+    for (size_t i=0; i<results.size(); ++i) {
+        const StageResult &result = results[i];
+        fprintf(stream, "  {\"source\": %s, \"width\": %d, \"height\": %d, \"megapixels\": %.2f, \"threads\": %d, "
+                        "\"binarizer\": %s, \"stage\": %s, \"repetitions\": %d, \"median_ms\": %.3f, \"min_ms\": %.3f, "
+                        "\"ms_per_megapixel\": %.3f, \"accuracy\": %s, \"result_hash\": \"%016llx\", "
+                        "\"computed_tiles\": %s}%s\n",
+                json_string(result.source).c_str(), result.width, result.height, result.megapixels(), result.threads,
+                json_string(result.binarizer).c_str(), json_string(result.stage).c_str(), result.repetitions,
+                result.median_ms, result.min_ms, result.median_ms / result.megapixels(),
+                std::isnan(result.accuracy) ? "null" : std::to_string(result.accuracy).c_str(),
+                (unsigned long long) result.result_hash,
+                std::isnan(result.computed_tiles) ? "null" : std::to_string(result.computed_tiles).c_str(),
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(stream, "]\n");
+}
+
+static void usage(const char* program) {
+    std::cerr<<"usage: "<<program<<" [-m megapixel,...] [-t threads,...] [-b statistics,filtering] [-r repetitions]"
+               " [-f csv|json] [-o output_file] [--rotation degrees] [-i directory | manifest]\n";
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    std::vector<double> megapixels = {2, 8, 12, 24, 48};
+    std::vector<double> threads = {1, (double) std::max(1u, std::thread::hardware_concurrency())};
+    std::vector<std::string> binarizers = {"statistics", "filtering"};
+    int repetitions = 3;
+    std::string format = "csv";
+    const char* output_path = nullptr;
+    const char* source = nullptr;
+    double rotation = 5;
+
+    for (int i=1; i<argc; ++i) {
+        if (!strcmp(argv[i], "-m") && i+1 < argc) megapixels = parse_list(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i+1 < argc) threads = parse_list(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i+1 < argc) binarizers = parse_names(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i+1 < argc) repetitions = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f") && i+1 < argc) format = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i+1 < argc) output_path = argv[++i];
+        else if (!strcmp(argv[i], "-i") && i+1 < argc) source = argv[++i];
+        else if (!strcmp(argv[i], "--rotation") && i+1 < argc) rotation = atof(argv[++i]);
+        else usage(argv[0]);
+    }
+    if (megapixels.empty() || threads.empty() || repetitions < 1) usage(argv[0]);
+    if (format != "csv" && format != "json") usage(argv[0]);
+    if (rotation < -15 || rotation > 15) usage(argv[0]);
+    for (double value : megapixels) if (value <= 0) usage(argv[0]);
+    for (double value : threads) if (value < 1) usage(argv[0]);
+    for (const std::string &binarizer : binarizers) {
+        if (binarizer != "statistics" && binarizer != "filtering") usage(argv[0]);
+    }
+    std::vector<std::string> inputs;
+    if (source) inputs = collect_batch_inputs(source);
+
+    std::vector<StageResult> results;
+    for (double target : megapixels) {
+        int width = (int) std::lround(std::sqrt(target * 1e6 * 4 / 3));
+        SyntheticScene scene = generate_synthetic_document(SyntheticDocument(width, width * 3 / 4, rotation, 1));
+        benchmark_image("synthetic", scene.image, &scene, threads, binarizers, repetitions, results);
+        for (const std::string &path : inputs) {
+            Mat image = imread(path, IMREAD_COLOR);
+            if (image.empty()) {
+                std::cerr<<"stage_benchmark: cannot read "<<path<<"\n";
+                continue;
+            }
+            benchmark_image(path, resize_to_megapixels(image, target), nullptr, threads, binarizers, repetitions, results);
+        }
+    }
+
+    FILE* stream = output_path ? fopen(output_path, "w") : stdout;
+    if (!stream) {
+        std::cerr<<"stage_benchmark: cannot open "<<output_path<<"\n";
+        return 1;
+    }
+    if (format == "csv") write_csv(stream, results);
+    else write_json(stream, results);
+    if (output_path) fclose(stream);
+    return 0;
+}